@@ -0,0 +1,1163 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "../src/BasicMemoryManager.h"
+#include "../src/MemoryManager.h"
+
+// Global heap calls made by the process, to show which paths allocate
+static size_t heapCalls = 0;
+
+void* operator new(size_t size) {
+    ++heapCalls;
+    if (void* ptr = std::malloc(size != 0 ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+// Random allocate/free churn, returns nanoseconds per operation
+template <typename Manager>
+double churn(Manager& mm, size_t operations, size_t maxBytes, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::vector<void*> live;
+    live.reserve(operations);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < operations; i++) {
+        if (live.empty() || rng() % 100 < 55) {
+            void* ptr = mm.allocate(1 + rng() % maxBytes);
+            if (ptr != nullptr) {
+                live.push_back(ptr);
+            }
+        } else {
+            size_t index = rng() % live.size();
+            mm.free(live[index]);
+            live[index] = live.back();
+            live.pop_back();
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    for (void* ptr : live) {
+        mm.free(ptr);
+    }
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / operations;
+}
+
+// Hardware cache event of this thread in user space, -1 if perf events are unavailable
+int openCacheCounter(uint64_t cache, uint64_t operation, uint64_t result) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = cache | (operation << 8) | (result << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+// Counter value as text, "n/a" without a counter
+std::string readCounter(int fd) {
+    uint64_t value = 0;
+    if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value)) {
+        return "n/a";
+    }
+    return std::to_string(value);
+}
+
+long pageFaults() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt + usage.ru_majflt;
+}
+
+// Resident set size of the process, in bytes
+size_t residentBytes() {
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    unsigned long size = 0, resident = 0;
+    if (statm != nullptr) {
+        if (std::fscanf(statm, "%lu %lu", &size, &resident) != 2) {
+            resident = 0;
+        }
+        std::fclose(statm);
+    }
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+void printSeparator(const char* title) {
+    std::cout << "\n" << std::string(50, '=') << "\n";
+    std::cout << title << "\n";
+    std::cout << std::string(50, '=') << "\n";
+}
+
+// Churn throughput of every engine on the same workload
+void benchEngines() {
+    printSeparator("Engines: churn throughput");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t POOL_SIZE = MemoryManager::MAX_NUM_WORDS;
+    const size_t OPERATIONS = 200000;
+
+    struct Case {
+        const char* name;
+        MemoryManager manager;
+    };
+
+    Case cases[] = {
+        { "best-fit", MemoryManager(WORD_SIZE, bestFit) },
+        { "worst-fit", MemoryManager(WORD_SIZE, worstFit) },
+        { "TLSF", MemoryManager(WORD_SIZE, MemoryManager::Engine::TLSF) },
+        { "WorstFit heap", MemoryManager(WORD_SIZE, MemoryManager::Engine::WorstFit) },
+        { "Bitmap", MemoryManager(WORD_SIZE, MemoryManager::Engine::Bitmap) },
+    };
+
+    std::cout << std::left << std::setw(16) << "engine" << "ns/op\n";
+
+    for (Case& c : cases) {
+        c.manager.initialize(POOL_SIZE);
+
+        std::cout << std::setw(16) << c.name << std::fixed << std::setprecision(1)
+                  << churn(c.manager, OPERATIONS, 256, 1) << "\n";
+    }
+}
+
+// Address-ordered first fit by walking the hole list
+MemoryManager::HoleView::const_iterator listFirstFit(int sizeInWords, const MemoryManager::HoleView& holes) {
+    for (auto it = holes.begin(); it != holes.end(); ++it) {
+        if (it->length >= static_cast<unsigned int>(sizeInWords)) {
+            return it;
+        }
+    }
+    return holes.end();
+}
+
+// Bitmap run search vs hole list walk, both first fit, with heavy churn
+void benchBitmap() {
+    printSeparator("Bitmap: first fit vs hole list walk");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t POOL_SIZES[] = { 512, 2048, 8192, MemoryManager::MAX_NUM_WORDS };
+    const size_t OPERATIONS = 500000;
+
+    std::cout << std::left << std::setw(12) << "words" << std::setw(16) << "list ns/op" << "bitmap ns/op\n";
+
+    for (size_t poolSize : POOL_SIZES) {
+        MemoryManager list(WORD_SIZE, listFirstFit);
+        list.initialize(poolSize);
+
+        MemoryManager bitmap(WORD_SIZE, MemoryManager::Engine::Bitmap);
+        bitmap.initialize(poolSize);
+
+        std::cout << std::setw(12) << poolSize << std::fixed << std::setprecision(1)
+                  << std::setw(16) << churn(list, OPERATIONS, 64, 1)
+                  << churn(bitmap, OPERATIONS, 64, 1) << "\n";
+    }
+}
+
+// Boundary tags vs out-of-band bookkeeping
+void benchLayout() {
+    printSeparator("Layout: out-of-band vs boundary tags");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t POOL_SIZE = MemoryManager::MAX_NUM_WORDS;
+    const size_t OPERATIONS = 200000;
+
+    struct Case {
+        const char* name;
+        MemoryManager::Layout layout;
+    };
+
+    const Case cases[] = {
+        { "out-of-band", MemoryManager::Layout::OutOfBand },
+        { "boundary tags", MemoryManager::Layout::BoundaryTags },
+    };
+
+    std::cout << std::left << std::setw(16) << "layout" << std::setw(14) << "engine"
+              << std::setw(16) << "bytes/block" << "ns/op\n";
+
+    for (const Case& c : cases) {
+        MemoryManager strategy(WORD_SIZE, bestFit);
+        strategy.initialize(POOL_SIZE, c.layout);
+
+        MemoryManager tlsf(WORD_SIZE, MemoryManager::Engine::TLSF);
+        tlsf.initialize(POOL_SIZE, c.layout);
+
+        std::cout << std::setw(16) << c.name << std::setw(14) << "best-fit"
+                  << std::setw(16) << strategy.getMetadataBytesPerBlock()
+                  << std::fixed << std::setprecision(1) << churn(strategy, OPERATIONS, 256, 1) << "\n";
+
+        std::cout << std::setw(16) << c.name << std::setw(14) << "TLSF"
+                  << std::setw(16) << tlsf.getMetadataBytesPerBlock()
+                  << churn(tlsf, OPERATIONS, 256, 1) << "\n";
+    }
+
+    std::cout << "\nOut-of-band also keeps three per-word lookup tables ("
+              << 3 * sizeof(void*) << " bytes/word) and a hole-start bitmap regardless of block count.\n";
+}
+
+// Free latency as the hole list grows, with the per-word tables lazily backed and prefaulted
+void benchFree() {
+    printSeparator("Free latency vs hole count");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t POOL_SIZE = MemoryManager::MAX_NUM_WORDS;
+    const size_t BLOCK_BYTES = WORD_SIZE;
+    const size_t FREES = 512;
+    const size_t HOLE_COUNTS[] = { 16, 64, 256, 1024, 4096, 16384 };
+
+    std::cout << std::left << std::setw(12) << "holes" << std::setw(16) << "lazy ns/free" << "prefault ns/free\n";
+
+    for (size_t holes : HOLE_COUNTS) {
+        std::cout << std::setw(12) << holes;
+
+        for (bool prefault : { false, true }) {
+            MemoryManager mm(WORD_SIZE, bestFit);
+            mm.setPrefaultTables(prefault);
+            mm.initialize(POOL_SIZE);
+
+            // Fill the pool, then punch 'holes' isolated holes at the front
+            std::vector<void*> blocks;
+            while (void* ptr = mm.allocate(BLOCK_BYTES)) {
+                blocks.push_back(ptr);
+            }
+
+            for (size_t i = 0; i < holes; i++) {
+                mm.free(blocks[2 * i]);
+            }
+
+            // Free a random sample of the remaining blocks
+            std::mt19937 rng(1);
+            std::vector<void*> sample(blocks.begin() + 2 * holes, blocks.end());
+            std::shuffle(sample.begin(), sample.end(), rng);
+            sample.resize(FREES);
+
+            auto start = std::chrono::steady_clock::now();
+
+            for (void* ptr : sample) {
+                mm.free(ptr);
+            }
+
+            auto end = std::chrono::steady_clock::now();
+
+            std::cout << std::setw(16) << std::fixed << std::setprecision(1)
+                      << std::chrono::duration<double, std::nano>(end - start).count() / FREES;
+        }
+
+        std::cout << "\n";
+    }
+
+    // Resident table memory right after initialize, for a 128 MiB pool
+    const size_t LARGE_POOL_SIZE = (size_t(128) << 20) / WORD_SIZE;
+
+    for (bool prefault : { false, true }) {
+        size_t baseline = residentBytes();
+
+        MemoryManager mm(WORD_SIZE, bestFit);
+        mm.setPrefaultTables(prefault);
+        mm.initialize(LARGE_POOL_SIZE);
+
+        size_t resident = residentBytes() > baseline ? residentBytes() - baseline : 0;
+        std::cout << (prefault ? "prefault" : "lazy") << " tables, 128 MiB pool: " << std::fixed << std::setprecision(1)
+                  << resident / 1048576.0 << " MiB resident after initialize\n";
+    }
+}
+
+// getBitmap on a fully populated pool, as a monitoring thread would call it
+void benchSnapshot() {
+    printSeparator("Snapshot: getBitmap on a full pool");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t POOL_SIZE = MemoryManager::MAX_NUM_WORDS;
+    const size_t BLOCK_BYTES = 4 * WORD_SIZE;
+    const size_t CALLS = 2000;
+
+    MemoryManager mm(WORD_SIZE, bestFit);
+    mm.initialize(POOL_SIZE);
+    while (mm.allocate(BLOCK_BYTES) != nullptr) {
+    }
+
+    std::cout << std::left << std::setw(24) << "call" << "ns/call\n";
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < CALLS; i++) {
+        delete[] static_cast<uint8_t*>(mm.getBitmap());
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    std::cout << std::setw(24) << "getBitmap()" << std::fixed << std::setprecision(1)
+              << std::chrono::duration<double, std::nano>(end - start).count() / CALLS << "\n";
+
+    std::vector<uint8_t> buffer(mm.getBitmapSize());
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < CALLS; i++) {
+        mm.getBitmap(buffer.data(), buffer.size());
+    }
+    end = std::chrono::steady_clock::now();
+
+    std::cout << std::setw(24) << "getBitmap(buffer)"
+              << std::chrono::duration<double, std::nano>(end - start).count() / CALLS << "\n";
+}
+
+// Fixed pool sized for the worst case vs a growable pool reserving the same range
+void benchGrow() {
+    printSeparator("Grow: fixed vs growable pool");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t RESERVED_WORDS = size_t(1) << 22;
+    const size_t INITIAL_WORDS = 4096;
+    const size_t OPERATIONS = 200000;
+
+    std::cout << std::left << std::setw(12) << "pool" << std::setw(16) << "committed KiB" << "ns/op\n";
+
+    MemoryManager fixed(WORD_SIZE, MemoryManager::Engine::TLSF);
+    fixed.initialize(RESERVED_WORDS);
+    double fixedTime = churn(fixed, OPERATIONS, 256, 1);
+
+    MemoryManager growable(WORD_SIZE, MemoryManager::Engine::TLSF);
+    growable.initializeGrowable(INITIAL_WORDS, RESERVED_WORDS);
+    double growableTime = churn(growable, OPERATIONS, 256, 1);
+
+    // Nothing committed until the first request
+    MemoryManager empty(WORD_SIZE, MemoryManager::Engine::TLSF);
+    empty.initializeGrowable(0, RESERVED_WORDS);
+    double emptyTime = churn(empty, OPERATIONS, 256, 1);
+
+    std::cout << std::setw(12) << "fixed" << std::setw(16) << fixed.getMemoryLimit() / 1024
+              << std::fixed << std::setprecision(1) << fixedTime << "\n";
+    std::cout << std::setw(12) << "growable" << std::setw(16) << growable.getMemoryLimit() / 1024
+              << growableTime << "\n";
+    std::cout << std::setw(12) << "from empty" << std::setw(16) << empty.getMemoryLimit() / 1024
+              << emptyTime << "\n";
+}
+
+// Load spike on a segmented pool: segments chained during the spike, released after it
+void benchSegments() {
+    printSeparator("Segments: load spike and release");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t SEGMENT_WORDS = 8192;
+    const size_t SPIKE_BLOCKS = 50000;
+    const size_t BLOCK_BYTES = 64;
+
+    MemoryManager mm(WORD_SIZE, MemoryManager::Engine::TLSF);
+    mm.initializeSegmented(SEGMENT_WORDS);
+
+    std::cout << std::left << std::setw(12) << "phase" << std::setw(12) << "segments"
+              << std::setw(16) << "mapped KiB" << "ns/op\n";
+
+    auto report = [&mm](const char* phase, double time) {
+        std::cout << std::setw(12) << phase << std::setw(12) << mm.getSegmentCount()
+                  << std::setw(16) << mm.getMemoryLimit() / 1024 << std::fixed << std::setprecision(1) << time << "\n";
+    };
+
+    std::vector<void*> spike;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < SPIKE_BLOCKS; i++) {
+        spike.push_back(mm.allocate(BLOCK_BYTES));
+    }
+    auto end = std::chrono::steady_clock::now();
+    report("spike", std::chrono::duration<double, std::nano>(end - start).count() / SPIKE_BLOCKS);
+
+    // Free in random order, routing every pointer through the address index
+    std::mt19937 rng(1);
+    std::shuffle(spike.begin(), spike.end(), rng);
+    start = std::chrono::steady_clock::now();
+    for (void* ptr : spike) {
+        mm.free(ptr);
+    }
+    end = std::chrono::steady_clock::now();
+    report("drained", std::chrono::duration<double, std::nano>(end - start).count() / SPIKE_BLOCKS);
+}
+
+// Random touches over a large pool with base pages vs huge pages
+void benchPages() {
+    printSeparator("Pages: TLB and page faults, base vs huge pages");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t POOL_SIZE = size_t(1) << 25;   // 256 MiB
+    const size_t BLOCK_BYTES = 4096;
+    const size_t TOUCHES = 4000000;
+
+    struct Case {
+        const char* name;
+        MemoryManager::Pages pages;
+    };
+
+    const Case cases[] = {
+        { "standard", MemoryManager::Pages::Standard },
+        { "transparent", MemoryManager::Pages::Transparent },
+        { "hugetlb", MemoryManager::Pages::HugeTlb },
+    };
+
+    std::cout << std::left << std::setw(14) << "requested" << std::setw(14) << "backing" << std::setw(14) << "faults"
+              << std::setw(14) << "dTLB misses" << "ns/touch\n";
+
+    for (const Case& c : cases) {
+        // Boundary tags keep the per-word tables out of the measurement
+        MemoryManager mm(WORD_SIZE, MemoryManager::Engine::TLSF);
+        mm.setPages(c.pages);
+        mm.initialize(POOL_SIZE, MemoryManager::Layout::BoundaryTags);
+
+        long faults = pageFaults();
+
+        std::vector<uint8_t*> blocks;
+        while (void* ptr = mm.allocate(BLOCK_BYTES)) {
+            blocks.push_back(static_cast<uint8_t*>(ptr));
+        }
+
+        for (uint8_t* block : blocks) {
+            block[0] = 1;
+        }
+
+        faults = pageFaults() - faults;
+
+        // Random single-byte touches, one TLB lookup each
+        std::mt19937 rng(1);
+        std::vector<uint32_t> order(TOUCHES);
+        for (uint32_t& index : order) {
+            index = static_cast<uint32_t>(rng() % blocks.size());
+        }
+
+        int misses = openCacheCounter(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+        if (misses >= 0) {
+            ioctl(misses, PERF_EVENT_IOC_RESET, 0);
+            ioctl(misses, PERF_EVENT_IOC_ENABLE, 0);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        unsigned int sum = 0;
+        for (uint32_t index : order) {
+            sum += blocks[index][BLOCK_BYTES / 2];
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        if (misses >= 0) {
+            ioctl(misses, PERF_EVENT_IOC_DISABLE, 0);
+        }
+
+        // Backing actually obtained after fallbacks
+        const char* backing = "standard";
+        for (const Case& other : cases) {
+            if (other.pages == mm.getPages()) {
+                backing = other.name;
+            }
+        }
+
+        std::cout << std::setw(14) << c.name << std::setw(14) << backing
+                  << std::setw(14) << faults << std::setw(14) << readCounter(misses)
+                  << std::fixed << std::setprecision(1)
+                  << std::chrono::duration<double, std::nano>(end - start).count() / TOUCHES << "\n";
+
+        // Keep the touches from being optimized away
+        asm volatile("" :: "r"(sum));
+
+        if (misses >= 0) {
+            close(misses);
+        }
+    }
+}
+
+// Resident memory after a drained spike, and the churn cost of each release policy
+void benchRelease() {
+    printSeparator("Release: RSS after a spike, churn cost");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t POOL_SIZE = size_t(1) << 23;   // 64 MiB
+    const size_t BLOCK_BYTES = 64 * 1024;
+
+    using Advice = MemoryManager::ReleasePolicy::Advice;
+
+    struct Case {
+        const char* name;
+        Advice advice;
+        size_t minReleaseBytes;
+    };
+
+    const Case cases[] = {
+        { "none", Advice::None, 0 },
+        { "dontneed", Advice::DontNeed, size_t(256) << 10 },
+        { "free", Advice::Free, size_t(256) << 10 },
+        { "dontneed/0", Advice::DontNeed, 0 },      // No hysteresis, every free of a large hole releases
+    };
+
+    std::cout << std::left << std::setw(14) << "advice" << std::setw(14) << "RSS MiB" << std::setw(16) << "released MiB"
+              << std::setw(14) << "free ns/op" << "churn ns/op\n";
+
+    for (const Case& c : cases) {
+        MemoryManager::ReleasePolicy policy;
+        policy.advice = c.advice;
+        policy.minReleaseBytes = c.minReleaseBytes;
+
+        MemoryManager mm(WORD_SIZE, MemoryManager::Engine::TLSF);
+        mm.setReleasePolicy(policy);
+        mm.initialize(POOL_SIZE);
+
+        size_t baseline = residentBytes();
+
+        std::vector<void*> spike;
+        while (void* ptr = mm.allocate(BLOCK_BYTES)) {
+            std::memset(ptr, 1, BLOCK_BYTES);
+            spike.push_back(ptr);
+        }
+
+        std::mt19937 rng(1);
+        std::shuffle(spike.begin(), spike.end(), rng);
+        auto start = std::chrono::steady_clock::now();
+        for (void* ptr : spike) {
+            mm.free(ptr);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        size_t resident = residentBytes() > baseline ? residentBytes() - baseline : 0;
+        double freeTime = std::chrono::duration<double, std::nano>(end - start).count() / spike.size();
+
+        // Mixed sizes up to 2 MiB keep holes above the release threshold forming and splitting
+        double churnTime = churn(mm, 200000, size_t(2) << 20, 7);
+
+        std::cout << std::setw(14) << c.name << std::setw(14) << resident / (1 << 20)
+                  << std::setw(16) << mm.getDecommittedBytes() / (1 << 20)
+                  << std::fixed << std::setprecision(1) << std::setw(14) << freeTime << churnTime << "\n";
+    }
+}
+
+// Inline release in free() vs the background scavenger: free latency and resident memory once idle
+void benchScavenger() {
+    printSeparator("Scavenger: inline vs background release");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t POOL_SIZE = size_t(1) << 23;   // 64 MiB
+    const size_t BLOCK_BYTES = 64 * 1024;
+
+    using Advice = MemoryManager::ReleasePolicy::Advice;
+
+    std::cout << std::left << std::setw(12) << "release" << std::setw(14) << "free ns/op" << std::setw(14) << "churn ns/op"
+              << std::setw(14) << "idle RSS MiB" << std::setw(10) << "passes" << std::setw(12) << "scan us" << "released MiB\n";
+
+    for (int mode = 0; mode < 3; mode++) {
+        MemoryManager::ReleasePolicy policy;
+        policy.advice = mode == 0 ? Advice::None : Advice::DontNeed;
+
+        MemoryManager::ScavengerConfig config;
+        config.interval = std::chrono::milliseconds(20);
+        config.idleTime = std::chrono::milliseconds(100);
+
+        MemoryManager mm(WORD_SIZE, MemoryManager::Engine::TLSF);
+        mm.setReleasePolicy(policy);
+        mm.initialize(POOL_SIZE);
+        if (mode == 2) {
+            mm.startScavenger(config);
+        }
+
+        size_t baseline = residentBytes();
+
+        std::vector<void*> spike;
+        while (void* ptr = mm.allocate(BLOCK_BYTES)) {
+            std::memset(ptr, 1, BLOCK_BYTES);
+            spike.push_back(ptr);
+        }
+
+        std::mt19937 rng(1);
+        std::shuffle(spike.begin(), spike.end(), rng);
+        auto start = std::chrono::steady_clock::now();
+        for (void* ptr : spike) {
+            mm.free(ptr);
+        }
+        auto end = std::chrono::steady_clock::now();
+        double freeTime = std::chrono::duration<double, std::nano>(end - start).count() / spike.size();
+
+        double churnTime = churn(mm, 200000, size_t(2) << 20, 7);
+
+        // Long enough for every hole to go idle and be scanned
+        std::this_thread::sleep_for(config.idleTime + 5 * config.interval);
+
+        size_t resident = residentBytes() > baseline ? residentBytes() - baseline : 0;
+        MemoryManager::ScavengerStats stats = mm.getScavengerStats();
+
+        const char* names[] = { "none", "inline", "scavenger" };
+        std::cout << std::setw(12) << names[mode] << std::fixed << std::setprecision(1)
+                  << std::setw(14) << freeTime << std::setw(14) << churnTime
+                  << std::setw(14) << resident / (1 << 20) << std::setw(10) << stats.passes
+                  << std::setw(12) << stats.scanNanoseconds / 1000.0 << stats.bytesReleased / (1 << 20) << "\n";
+    }
+}
+
+// Churn with aligned requests: throughput and holes left behind by the slack, per engine and alignment
+void benchAligned() {
+    printSeparator("Aligned: churn with allocateAligned");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t POOL_SIZE = size_t(1) << 23;   // 64 MiB, enough that even 4 KiB slots never run out
+    const size_t OPERATIONS = 100000;
+
+    struct Case {
+        const char* name;
+        MemoryManager::Engine engine;
+    };
+
+    const Case cases[] = {
+        { "best-fit", MemoryManager::Engine::Strategy },
+        { "TLSF", MemoryManager::Engine::TLSF },
+        { "WorstFit heap", MemoryManager::Engine::WorstFit },
+        { "Bitmap", MemoryManager::Engine::Bitmap },
+    };
+
+    const size_t alignments[] = { 0, 64, 4096 };
+
+    std::cout << std::left << std::setw(16) << "engine" << std::setw(12) << "alignment"
+              << std::setw(12) << "ns/op" << "holes\n";
+
+    for (const Case& c : cases) {
+        for (size_t alignment : alignments) {
+            MemoryManager mm(WORD_SIZE, c.engine);
+            mm.initialize(POOL_SIZE);
+
+            std::mt19937 rng(1);
+            std::vector<void*> live;
+            size_t holes = 0;
+
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < OPERATIONS; i++) {
+                if (live.empty() || rng() % 100 < 55) {
+                    size_t size = 1 + rng() % 2048;
+                    void* ptr = alignment == 0 ? mm.allocate(size) : mm.allocateAligned(size, alignment);
+                    if (ptr != nullptr) {
+                        live.push_back(ptr);
+                    }
+                } else {
+                    size_t index = rng() % live.size();
+                    mm.free(live[index]);
+                    live[index] = live.back();
+                    live.pop_back();
+                }
+            }
+            auto end = std::chrono::steady_clock::now();
+
+            uint64_t* list = static_cast<uint64_t*>(mm.getList(MemoryManager::Format::Wide));
+            holes = list != nullptr ? list[0] : 0;
+            delete[] list;
+
+            std::cout << std::setw(16) << c.name << std::setw(12) << (alignment == 0 ? std::string("word") : std::to_string(alignment))
+                      << std::fixed << std::setprecision(1) << std::setw(12)
+                      << std::chrono::duration<double, std::nano>(end - start).count() / OPERATIONS << holes << "\n";
+
+            for (void* ptr : live) {
+                mm.free(ptr);
+            }
+        }
+    }
+}
+
+// Growable buffers appended to in steps: reallocate vs allocate + memcpy + free
+void benchReallocate() {
+    printSeparator("Reallocate: growing buffers");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t POOL_SIZE = size_t(1) << 22;   // 32 MiB
+    const size_t BUFFERS = 64;
+    const size_t STEPS = 2000;
+    const size_t STEP_BYTES = 256;
+
+    std::cout << std::left << std::setw(14) << "method" << std::setw(12) << "ns/step"
+              << std::setw(12) << "in place" << "moved\n";
+
+    for (int method = 0; method < 2; method++) {
+        MemoryManager mm(WORD_SIZE, MemoryManager::Engine::TLSF);
+        mm.initialize(POOL_SIZE);
+
+        std::vector<void*> buffers(BUFFERS, nullptr);
+        std::vector<size_t> sizes(BUFFERS, 0);
+        std::mt19937 rng(1);
+        size_t copies = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t step = 0; step < STEPS * BUFFERS / 4; step++) {
+            // Interleaved appends to random buffers, occasionally one is dropped and restarts
+            size_t index = rng() % BUFFERS;
+            if (sizes[index] >= STEPS * STEP_BYTES / 8 || rng() % 64 == 0) {
+                mm.free(buffers[index]);
+                buffers[index] = nullptr;
+                sizes[index] = 0;
+            }
+
+            size_t size = sizes[index] + STEP_BYTES;
+            if (method == 0) {
+                buffers[index] = mm.reallocate(buffers[index], size);
+            } else {
+                void* grown = mm.allocate(size);
+                if (buffers[index] != nullptr) {
+                    std::memcpy(grown, buffers[index], sizes[index]);
+                    mm.free(buffers[index]);
+                    copies++;
+                }
+                buffers[index] = grown;
+            }
+            sizes[index] = size;
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        MemoryManager::ReallocateStats stats = mm.getReallocateStats();
+        std::cout << std::setw(14) << (method == 0 ? "reallocate" : "copy") << std::fixed << std::setprecision(1)
+                  << std::setw(12) << std::chrono::duration<double, std::nano>(end - start).count() / (STEPS * BUFFERS / 4)
+                  << std::setw(12) << stats.grownInPlace + stats.shrunkInPlace
+                  << (method == 0 ? stats.moved : copies) << "\n";
+
+        for (void* buffer : buffers) {
+            mm.free(buffer);
+        }
+    }
+}
+
+// One buffer grown to 4 MiB in 64 KiB steps, in the pool vs in its own mremap-resized mapping
+void benchLarge() {
+    printSeparator("Large blocks: pool vs mremap growth");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t POOL_SIZE = size_t(1) << 25;   // 256 MiB, room for every moved copy
+    const size_t STEP_BYTES = 64 * 1024;
+    const size_t FINAL_BYTES = size_t(4) << 20;
+
+    std::cout << std::left << std::setw(12) << "backing" << std::setw(14) << "us/step" << std::setw(10) << "moved"
+              << "remapped\n";
+
+    for (int mode = 0; mode < 2; mode++) {
+        MemoryManager mm(WORD_SIZE, MemoryManager::Engine::WorstFit);
+        mm.initialize(POOL_SIZE, MemoryManager::Layout::BoundaryTags);
+        if (mode == 1) {
+            mm.setLargeBlockThreshold(STEP_BYTES);
+        }
+
+        // Worst fit puts a small neighbour right after the buffer each step, so the pool buffer cannot grow in place
+        std::vector<void*> neighbours;
+        void* buffer = nullptr;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t size = STEP_BYTES; size <= FINAL_BYTES; size += STEP_BYTES) {
+            buffer = mm.reallocate(buffer, size);
+            static_cast<uint8_t*>(buffer)[size - 1] = 1;
+            neighbours.push_back(mm.allocate(64));
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        MemoryManager::ReallocateStats stats = mm.getReallocateStats();
+        std::cout << std::setw(12) << (mode == 0 ? "pool" : "mremap") << std::fixed << std::setprecision(1) << std::setw(14)
+                  << std::chrono::duration<double, std::micro>(end - start).count() / (FINAL_BYTES / STEP_BYTES)
+                  << std::setw(10) << stats.moved << stats.remapped << "\n";
+
+        mm.free(buffer);
+        for (void* neighbour : neighbours) {
+            mm.free(neighbour);
+        }
+    }
+}
+
+// Runtime strategy through std::function vs the same policy inlined by BasicMemoryManager
+void benchPolicy() {
+    printSeparator("Policy: std::function vs compile-time strategy");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t POOL_SIZE = MemoryManager::MAX_NUM_WORDS;
+    const size_t OPERATIONS = 1000000;
+
+    std::cout << std::left << std::setw(14) << "workload" << std::setw(16) << "std::function" << std::setw(16) << "policy"
+              << "speedup\n";
+
+    // Allocations only: fill a churned pool with small blocks, timing just the allocate calls
+    auto fill = [](auto& mm) {
+        std::mt19937 rng(2);
+        std::vector<void*> blocks;
+        auto start = std::chrono::steady_clock::now();
+        while (void* ptr = mm.allocate(1 + rng() % 64)) {
+            blocks.push_back(ptr);
+        }
+        auto end = std::chrono::steady_clock::now();
+        for (void* ptr : blocks) {
+            mm.free(ptr);
+        }
+        return std::chrono::duration<double, std::nano>(end - start).count() / blocks.size();
+    };
+
+    auto report = [](const char* name, double runtime, double inlined) {
+        std::cout << std::setw(14) << name << std::fixed << std::setprecision(1) << std::setw(16) << runtime
+                  << std::setw(16) << inlined << std::setprecision(2) << runtime / inlined << "x\n";
+    };
+
+    {
+        MemoryManager runtime(WORD_SIZE, bestFit);
+        BasicMemoryManager<BestFitPolicy, WORD_SIZE> inlined;
+        runtime.initialize(POOL_SIZE);
+        inlined.initialize(POOL_SIZE);
+        report("best churn", churn(runtime, OPERATIONS, 256, 1), churn(inlined, OPERATIONS, 256, 1));
+        report("best fill", fill(runtime), fill(inlined));
+    }
+
+    {
+        MemoryManager runtime(WORD_SIZE, worstFit);
+        BasicMemoryManager<WorstFitPolicy, WORD_SIZE> inlined;
+        runtime.initialize(POOL_SIZE);
+        inlined.initialize(POOL_SIZE);
+        report("worst churn", churn(runtime, OPERATIONS, 256, 1), churn(inlined, OPERATIONS, 256, 1));
+        report("worst fill", fill(runtime), fill(inlined));
+    }
+}
+
+// Allocate/free of small blocks per word size: shifts for powers of two, divisions otherwise
+void benchWordSize() {
+    printSeparator("Word size: allocate + free pairs");
+
+    const size_t POOL_BYTES = size_t(1) << 22;
+    const size_t BLOCKS = 4096;
+    const size_t ROUNDS = 200;
+
+    const unsigned int wordSizes[] = { 4, 8, 16, 12 };
+
+    std::cout << std::left << std::setw(12) << "word size" << std::setw(12) << "path" << "ns/pair\n";
+
+    for (unsigned int wordSize : wordSizes) {
+        MemoryManager mm(wordSize, MemoryManager::Engine::TLSF);
+        mm.initialize(POOL_BYTES / wordSize, MemoryManager::Layout::BoundaryTags);
+
+        std::mt19937 rng(1);
+        std::vector<size_t> sizes(BLOCKS);
+        for (size_t& size : sizes) {
+            size = 1 + rng() % 128;
+        }
+
+        std::vector<void*> blocks(BLOCKS);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < ROUNDS; round++) {
+            for (size_t i = 0; i < BLOCKS; i++) {
+                blocks[i] = mm.allocate(sizes[i]);
+            }
+            for (size_t i = 0; i < BLOCKS; i++) {
+                mm.free(blocks[(i * 7919) % BLOCKS]);
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        bool shifts = (wordSize & (wordSize - 1)) == 0;
+        std::cout << std::setw(12) << wordSize << std::setw(12) << (shifts ? "shift" : "divide") << std::fixed
+                  << std::setprecision(1) << std::chrono::duration<double, std::nano>(end - start).count() / (ROUNDS * BLOCKS)
+                  << "\n";
+    }
+}
+
+// Metadata node cost: churn and full hole-list walks with heap calls and cache misses per operation
+void benchNodes() {
+    printSeparator("Nodes: hole and block list metadata");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t POOL_SIZE = MemoryManager::MAX_NUM_WORDS;
+    const size_t OPERATIONS = 200000;
+
+    // Visits every hole before taking the first fit, so lookups are list walks
+    MemoryManager::Strategy walkFit = [](int sizeInWords, const MemoryManager::HoleView& holes) {
+        auto chosen = holes.end();
+        for (auto hole = holes.begin(); hole != holes.end(); ++hole) {
+            if (chosen == holes.end() && hole->length >= static_cast<unsigned int>(sizeInWords)) {
+                chosen = hole;
+            }
+        }
+        return chosen;
+    };
+
+    struct Case {
+        const char* name;
+        MemoryManager manager;
+        MemoryManager::Layout layout;
+        size_t operations;
+    };
+
+    Case cases[] = {
+        { "best-fit", MemoryManager(WORD_SIZE, bestFit), MemoryManager::Layout::OutOfBand, OPERATIONS },
+        { "TLSF", MemoryManager(WORD_SIZE, MemoryManager::Engine::TLSF), MemoryManager::Layout::OutOfBand, OPERATIONS },
+        { "TLSF tags", MemoryManager(WORD_SIZE, MemoryManager::Engine::TLSF), MemoryManager::Layout::BoundaryTags, OPERATIONS },
+        { "list walk", MemoryManager(WORD_SIZE, walkFit), MemoryManager::Layout::OutOfBand, OPERATIONS / 10 },
+    };
+
+    std::cout << std::left << std::setw(12) << "case" << std::setw(12) << "ns/op" << std::setw(14) << "heap/op"
+              << std::setw(14) << "L1D miss" << "LLC miss\n";
+
+    for (Case& c : cases) {
+        c.manager.initialize(POOL_SIZE, c.layout);
+
+        // Warm up so list nodes of the steady state already exist
+        churn(c.manager, c.operations, 256, 2);
+
+        int counters[] = {
+            openCacheCounter(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS),
+            openCacheCounter(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS),
+        };
+        for (int fd : counters) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+
+        size_t calls = heapCalls;
+        double ns = churn(c.manager, c.operations, 256, 1);
+        calls = heapCalls - calls;
+
+        std::string misses[2];
+        for (int i = 0; i < 2; i++) {
+            if (counters[i] >= 0) {
+                ioctl(counters[i], PERF_EVENT_IOC_DISABLE, 0);
+                std::string total = readCounter(counters[i]);
+                misses[i] = total == "n/a" ? total : std::to_string(std::stoull(total) / c.operations);
+                close(counters[i]);
+            } else {
+                misses[i] = "n/a";
+            }
+        }
+
+        // The churn's own vector reserve is one call
+        std::cout << std::setw(12) << c.name << std::fixed << std::setprecision(1) << std::setw(12) << ns
+                  << std::setprecision(3) << std::setw(14) << static_cast<double>(calls - 1) / c.operations
+                  << std::setw(14) << misses[0] << misses[1] << "\n";
+    }
+}
+
+// Size index lookups at growing hole counts: ordered tree against the SIMD-scanned hole table
+void benchSizeIndex() {
+    printSeparator("Size index: tree vs hole table");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t PAIRS = 200000;
+    const size_t holeCounts[] = { 16, 64, 256, 1024, 8192 };
+
+    struct Case {
+        const char* name;
+        MemoryManager::Strategy strategy;
+    };
+
+    const Case cases[] = {
+        { "best-fit", bestFit },
+        { "worst-fit", worstFit },
+    };
+
+    std::cout << std::left << std::setw(12) << "strategy" << std::setw(10) << "holes" << std::setw(14) << "tree ns"
+              << "table ns\n";
+
+    for (const Case& c : cases) {
+        for (size_t holes : holeCounts) {
+            double ns[2];
+            size_t made = 0;
+
+            for (int table = 0; table < 2; table++) {
+                MemoryManager mm(WORD_SIZE, c.strategy);
+                mm.setSizeIndex(table ? MemoryManager::SizeIndex::Table : MemoryManager::SizeIndex::Tree);
+                mm.initialize(holes * 2 * 17);
+
+                // About 'holes' holes of 1 to 32 words between pinned blocks
+                std::mt19937 rng(1);
+                std::vector<void*> blocks;
+                while (void* ptr = mm.allocate(WORD_SIZE * (1 + rng() % 32))) {
+                    blocks.push_back(ptr);
+                }
+                for (size_t i = 0; i < blocks.size(); i += 2) {
+                    mm.free(blocks[i]);
+                }
+                made = (blocks.size() + 1) / 2;
+
+                // Each pair leaves the hole set as it found it
+                std::vector<size_t> sizes(1024);
+                for (size_t& size : sizes) {
+                    size = WORD_SIZE * (1 + rng() % 16);
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < PAIRS; i++) {
+                    mm.free(mm.allocate(sizes[i % sizes.size()]));
+                }
+                auto end = std::chrono::steady_clock::now();
+
+                ns[table] = std::chrono::duration<double, std::nano>(end - start).count() / PAIRS;
+            }
+
+            std::cout << std::setw(12) << c.name << std::setw(10) << made << std::fixed << std::setprecision(1)
+                      << std::setw(14) << ns[0] << ns[1] << "\n";
+        }
+    }
+}
+
+// Short-lived request buffers under each shipped strategy: search length, throughput and fragmentation
+void benchFits() {
+    printSeparator("Fits: first, next, best and worst fit");
+
+    const unsigned int WORD_SIZE = 8;
+    const size_t POOL_SIZE = size_t(1) << 16;
+    const size_t OPERATIONS = 200000;
+    const size_t MAX_BYTES = 1024;
+    const size_t LIVE = 256;        // About a quarter of the pool
+    const size_t OLDEST = 16;
+
+    using Iterator = MemoryManager::HoleView::const_iterator;
+
+    struct Case {
+        const char* name;
+        MemoryManager::Strategy strategy;
+        bool scans;     // Walks the list, so the holes it examines are counted
+        bool roving;    // Walks from the rover rather than the front
+    };
+
+    const Case cases[] = {
+        { "first-fit", firstFit, true, false },
+        { "next-fit", nextFit, true, true },
+        { "best-fit", bestFit, false, false },
+        { "worst-fit", worstFit, false, false },
+    };
+
+    std::cout << std::left << std::setw(12) << "strategy" << std::setw(10) << "ns/pair" << std::setw(12) << "visited"
+              << std::setw(10) << "holes" << std::setw(10) << "failed" << "frag\n";
+
+    for (const Case& c : cases) {
+        // Holes examined up to the chosen one, wrapping around for next-fit; all of them on a miss
+        double visited = 0;
+        size_t searches = 0;
+        MemoryManager::Strategy counted = [&](int sizeInWords, const MemoryManager::HoleView& holes) {
+            Iterator hole = c.roving && holes.rover() != holes.end() ? holes.rover() : holes.begin();
+            Iterator chosen = c.strategy(sizeInWords, holes);
+
+            size_t steps = holes.size();
+            if (chosen != holes.end()) {
+                for (steps = 1; hole != chosen; steps++) {
+                    hole = std::next(hole) == holes.end() ? holes.begin() : std::next(hole);
+                }
+            }
+
+            visited += steps;
+            searches++;
+            return chosen;
+        };
+
+        // Each step allocates a buffer and, past 'LIVE' buffers, frees one of the oldest few
+        auto run = [&](MemoryManager& mm, std::deque<void*>& live) {
+            std::mt19937 rng(1);
+            size_t failed = 0;
+
+            for (size_t i = 0; i < OPERATIONS; i++) {
+                void* ptr = mm.allocate(1 + rng() % MAX_BYTES);
+                if (ptr != nullptr) {
+                    live.push_back(ptr);
+                } else {
+                    failed++;
+                }
+
+                if (live.size() > LIVE) {
+                    size_t index = rng() % OLDEST;
+                    mm.free(live[index]);
+                    live.erase(live.begin() + index);
+                }
+            }
+
+            return failed;
+        };
+
+        MemoryManager timed(WORD_SIZE, c.strategy);
+        timed.initialize(POOL_SIZE);
+        std::deque<void*> live;
+
+        auto start = std::chrono::steady_clock::now();
+        run(timed, live);
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count() / OPERATIONS;
+
+        // Same workload again, instrumented, read with its buffers still live
+        MemoryManager mm(WORD_SIZE, c.scans ? counted : c.strategy);
+        mm.initialize(POOL_SIZE);
+        live.clear();
+        size_t failed = run(mm, live);
+
+        // External fragmentation: share of free words outside the largest hole
+        uint64_t* list = static_cast<uint64_t*>(mm.getList(MemoryManager::Format::Wide));
+        uint64_t holes = list != nullptr ? list[0] : 0;
+        uint64_t freeWords = 0;
+        uint64_t largest = 0;
+        for (uint64_t i = 0; i < holes; i++) {
+            freeWords += list[2 + 2 * i];
+            largest = std::max(largest, list[2 + 2 * i]);
+        }
+        delete[] list;
+
+        std::cout << std::setw(12) << c.name << std::fixed << std::setprecision(1) << std::setw(10) << ns << std::setw(12)
+                  << (c.scans ? std::to_string(visited / searches).substr(0, 5) : std::string("log")) << std::setw(10) << holes
+                  << std::setw(10) << failed << std::setprecision(3) << (freeWords != 0 ? 1.0 - double(largest) / freeWords : 0.0)
+                  << "\n";
+
+        for (void* ptr : live) {
+            mm.free(ptr);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    struct Benchmark {
+        const char* name;
+        void (*run)();
+    };
+
+    const Benchmark benchmarks[] = {
+        { "engines", benchEngines },
+        { "layout", benchLayout },
+        { "bitmap", benchBitmap },
+        { "free", benchFree },
+        { "snapshot", benchSnapshot },
+        { "grow", benchGrow },
+        { "segments", benchSegments },
+        { "pages", benchPages },
+        { "release", benchRelease },
+        { "scavenger", benchScavenger },
+        { "aligned", benchAligned },
+        { "reallocate", benchReallocate },
+        { "large", benchLarge },
+        { "policy", benchPolicy },
+        { "wordsize", benchWordSize },
+        { "nodes", benchNodes },
+        { "sizeindex", benchSizeIndex },
+        { "fits", benchFits },
+    };
+
+    // Run the named benchmarks, or all of them
+    for (const Benchmark& benchmark : benchmarks) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; i++) {
+            selected = selected || std::strcmp(argv[i], benchmark.name) == 0;
+        }
+
+        if (selected) {
+            benchmark.run();
+        }
+    }
+
+    return 0;
+}
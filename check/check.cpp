@@ -0,0 +1,711 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../src/MemoryManager.h"
+
+// Equivalence and invariant checks, run by 'make check'. Every check replays
+// seeded random workloads, so a failure reproduces exactly; the program exits
+// non-zero if any check failed.
+
+using Engine = MemoryManager::Engine;
+using Layout = MemoryManager::Layout;
+using HoleView = MemoryManager::HoleView;
+
+static size_t failures = 0;
+
+// Records a failure, printing the first few
+static bool expect(bool condition, const std::string& what) {
+    if (!condition && failures++ < 20) {
+        std::cout << "  FAIL " << what << "\n";
+    }
+    return condition;
+}
+
+// Word offset of a block, -1 for nullptr, so placements compare across pools
+static int64_t offsetOf(MemoryManager& mm, void* ptr) {
+    if (ptr == nullptr) {
+        return -1;
+    }
+    return (static_cast<uint8_t*>(ptr) - static_cast<uint8_t*>(mm.getMemoryStart())) / mm.getWordSize();
+}
+
+// Holes as (offset, length) pairs in address order
+static std::vector<std::pair<uint64_t, uint64_t>> holesOf(MemoryManager& mm) {
+    std::vector<std::pair<uint64_t, uint64_t>> holes;
+    uint64_t* list = static_cast<uint64_t*>(mm.getList(MemoryManager::Format::Wide));
+    if (list != nullptr) {
+        for (uint64_t i = 0; i < list[0]; i++) {
+            holes.push_back({ list[1 + 2 * i], list[2 + 2 * i] });
+        }
+        delete[] list;
+    }
+
+    std::sort(holes.begin(), holes.end());
+    return holes;
+}
+
+// A block handed out by the manager, filled with a pattern derived from 'tag'
+struct Block {
+    uint8_t* address;
+    size_t bytes;
+    uint8_t tag;
+};
+
+static void fill(const Block& block) {
+    for (size_t i = 0; i < block.bytes; i++) {
+        block.address[i] = static_cast<uint8_t>(block.tag + i);
+    }
+}
+
+static bool intact(const Block& block, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        if (block.address[i] != static_cast<uint8_t>(block.tag + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Holes lie inside the pool, never overlap or touch (they would have been merged),
+// match the allocation bitmap word for word, and no live block reaches into one
+static void checkInvariants(MemoryManager& mm, const std::vector<Block>& live, const std::string& name) {
+    size_t words = mm.getMemoryLimit() / mm.getWordSize();
+    auto holes = holesOf(mm);
+
+    std::vector<uint8_t> bitmap(mm.getBitmapSize(MemoryManager::Format::Wide));
+    if (!expect(mm.getBitmap(bitmap.data(), bitmap.size(), MemoryManager::Format::Wide) == bitmap.size(), name + ": bitmap copy")) {
+        return;
+    }
+    auto allocated = [&](size_t word) { return (bitmap[8 + word / 8] >> (word % 8)) & 1; };
+
+    std::vector<bool> inHole(words, false);
+    for (size_t i = 0; i < holes.size(); i++) {
+        uint64_t offset = holes[i].first;
+        uint64_t length = holes[i].second;
+
+        if (length == 0 || offset + length > words) {
+            expect(false, name + ": hole outside the pool at " + std::to_string(offset));
+            return;
+        }
+        if (i > 0 && holes[i - 1].first + holes[i - 1].second >= offset) {
+            expect(false, name + ": holes overlap or touch at " + std::to_string(offset));
+            return;
+        }
+
+        for (uint64_t word = offset; word < offset + length; word++) {
+            inHole[word] = true;
+        }
+    }
+
+    for (size_t word = 0; word < words; word++) {
+        if (allocated(word) == inHole[word]) {
+            expect(false, name + ": bitmap disagrees with the holes at word " + std::to_string(word));
+            return;
+        }
+    }
+
+    for (const Block& block : live) {
+        size_t first = offsetOf(mm, block.address);
+        size_t last = (block.address + block.bytes - 1 - static_cast<uint8_t*>(mm.getMemoryStart())) / mm.getWordSize();
+        for (size_t word = first; word <= last; word++) {
+            if (inHole[word]) {
+                expect(false, name + ": live block in a hole at word " + std::to_string(word));
+                return;
+            }
+        }
+    }
+}
+
+// Which calls a workload mixes in besides allocate and free
+struct Mix {
+    bool aligned;
+    bool reallocate;
+    bool switchIndex;   // setSizeIndex to a random index, separately for each manager
+};
+
+// Replays one seeded allocate/allocateAligned/reallocate/free sequence on every manager.
+// Each call must place its block at the same word offset in all of them as in the first,
+// block contents must survive, and every manager is checked for the invariants as it goes
+// and must be back to a single hole once everything is freed.
+static void replay(const std::vector<MemoryManager*>& managers, unsigned int seed, size_t operations, Mix mix, const std::string& name) {
+    std::mt19937 rng(seed);
+    std::vector<std::vector<Block>> live(managers.size());
+    size_t count = 0;  // Blocks live in every manager
+
+    for (size_t step = 0; step < operations; step++) {
+        unsigned int choice = rng() % 100;
+        std::string at = name + " step " + std::to_string(step);
+
+        if (mix.switchIndex && choice == 0) {
+            for (MemoryManager* mm : managers) {
+                mm->setSizeIndex(rng() % 2 == 0 ? MemoryManager::SizeIndex::Tree : MemoryManager::SizeIndex::Table);
+            }
+        }
+
+        if (count == 0 || choice < 50) {
+            size_t bytes = 1 + rng() % 400;
+            size_t alignment = mix.aligned && rng() % 4 == 0 ? size_t(1) << (rng() % 13) : 0;
+            uint8_t tag = static_cast<uint8_t>(rng());
+
+            std::vector<void*> results;
+            for (MemoryManager* mm : managers) {
+                results.push_back(alignment != 0 ? mm->allocateAligned(bytes, alignment) : mm->allocate(bytes));
+            }
+
+            bool placed = true;
+            for (size_t i = 0; i < managers.size(); i++) {
+                placed = expect(offsetOf(*managers[i], results[i]) == offsetOf(*managers[0], results[0]), at + ": placement differs") && placed;
+                placed = expect(alignment == 0 || reinterpret_cast<uintptr_t>(results[i]) % alignment == 0, at + ": misaligned") && placed;
+            }
+            if (!placed) {
+                return;
+            }
+
+            if (results[0] != nullptr) {
+                for (size_t i = 0; i < managers.size(); i++) {
+                    live[i].push_back(Block{ static_cast<uint8_t*>(results[i]), bytes, tag });
+                    fill(live[i].back());
+                }
+                count++;
+            }
+
+        } else if (mix.reallocate && choice < 65) {
+            size_t index = rng() % count;
+            size_t bytes = 1 + rng() % 800;
+            uint8_t tag = static_cast<uint8_t>(rng());
+
+            std::vector<void*> results;
+            for (size_t i = 0; i < managers.size(); i++) {
+                results.push_back(managers[i]->reallocate(live[i][index].address, bytes));
+            }
+
+            for (size_t i = 0; i < managers.size(); i++) {
+                if (!expect(offsetOf(*managers[i], results[i]) == offsetOf(*managers[0], results[0]), at + ": reallocate placement differs")) {
+                    return;
+                }
+
+                // A failed reallocate leaves the block where it was
+                if (results[i] == nullptr) {
+                    continue;
+                }
+
+                Block& block = live[i][index];
+                block.address = static_cast<uint8_t*>(results[i]);
+                if (!expect(intact(block, std::min(block.bytes, bytes)), at + ": reallocate lost contents")) {
+                    return;
+                }
+                block.bytes = bytes;
+                block.tag = tag;
+                fill(block);
+            }
+
+        } else {
+            size_t index = rng() % count;
+            for (size_t i = 0; i < managers.size(); i++) {
+                if (!expect(intact(live[i][index], live[i][index].bytes), at + ": block overwritten")) {
+                    return;
+                }
+                managers[i]->free(live[i][index].address);
+                live[i][index] = live[i].back();
+                live[i].pop_back();
+            }
+            count--;
+        }
+
+        if (step % 64 == 0) {
+            for (size_t i = 0; i < managers.size(); i++) {
+                checkInvariants(*managers[i], live[i], at);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < managers.size(); i++) {
+        for (const Block& block : live[i]) {
+            managers[i]->free(block.address);
+        }
+        live[i].clear();
+
+        checkInvariants(*managers[i], live[i], name + " after freeing everything");
+        auto holes = holesOf(*managers[i]);
+        expect(holes.size() == 1 && holes[0].second == managers[i]->getMemoryLimit() / managers[i]->getWordSize(),
+               name + ": not coalesced into one hole after freeing everything");
+    }
+}
+
+static const char* layoutName(Layout layout) {
+    return layout == Layout::OutOfBand ? "out-of-band" : "boundary tags";
+}
+
+// Reports one check's outcome
+static void report(const std::string& name, size_t failuresBefore) {
+    std::cout << (failures == failuresBefore ? "  ok    " : "  FAIL  ") << name << "\n";
+}
+
+// Invariants
+
+static void checkEngines() {
+    std::cout << "Invariants: every engine, layout and word size\n";
+
+    struct Case {
+        const char* name;
+        Engine engine;
+    };
+
+    const Case cases[] = {
+        { "Strategy", Engine::Strategy },
+        { "TLSF", Engine::TLSF },
+        { "WorstFit", Engine::WorstFit },
+        { "Bitmap", Engine::Bitmap },
+    };
+
+    for (const Case& c : cases) {
+        for (Layout layout : { Layout::OutOfBand, Layout::BoundaryTags }) {
+            for (unsigned int wordSize : { 8u, 12u }) {
+                std::string name = std::string(c.name) + ", " + layoutName(layout) + ", " + std::to_string(wordSize) + "-byte words";
+                size_t failuresBefore = failures;
+
+                for (unsigned int seed = 1; seed <= 3; seed++) {
+                    MemoryManager fixed(wordSize, c.engine);
+                    fixed.initialize(20000, layout);
+                    replay({ &fixed }, seed, 20000, Mix{ true, true, false }, name);
+
+                    // Starts empty, so every hole comes from grow()
+                    MemoryManager growable(wordSize, c.engine);
+                    growable.initializeGrowable(0, 40000, layout);
+                    replay({ &growable }, seed, 20000, Mix{ true, true, false }, name + ", growable");
+
+                    // Tables faulted in on initialize and on every grow
+                    MemoryManager prefaulted(wordSize, c.engine);
+                    prefaulted.setPrefaultTables(true);
+                    prefaulted.initializeGrowable(4096, 40000, layout);
+                    replay({ &prefaulted }, seed, 20000, Mix{ true, true, false }, name + ", prefaulted");
+                }
+
+                report(name, failuresBefore);
+            }
+        }
+    }
+}
+
+// Size-ordered strategies against linear scans
+
+// What 'bestFit' computed before the size index: the smallest usable hole, lowest offset on ties
+static HoleView::const_iterator scanBestFit(int sizeInWords, const HoleView& holes) {
+    auto best = holes.end();
+    for (auto hole = holes.begin(); hole != holes.end(); ++hole) {
+        unsigned int length = holes.usableLength(hole);
+        if (length >= static_cast<unsigned int>(sizeInWords)
+            && (best == holes.end() || length < best->length || (length == best->length && hole->offset < best->offset))) {
+            best = hole;
+        }
+    }
+    return best;
+}
+
+// What 'worstFit' computed before the size index: the largest hole, lowest offset on ties
+static HoleView::const_iterator scanWorstFit(int sizeInWords, const HoleView& holes) {
+    auto worst = holes.end();
+    for (auto hole = holes.begin(); hole != holes.end(); ++hole) {
+        if (worst == holes.end() || hole->length > worst->length || (hole->length == worst->length && hole->offset < worst->offset)) {
+            worst = hole;
+        }
+    }
+
+    if (worst == holes.end() || holes.usableLength(worst) < static_cast<unsigned int>(sizeInWords)) {
+        return holes.end();
+    }
+    return worst;
+}
+
+static void checkStrategies() {
+    std::cout << "Equivalence: size-ordered strategies and engines against linear scans\n";
+
+    for (Layout layout : { Layout::OutOfBand, Layout::BoundaryTags }) {
+        size_t failuresBefore = failures;
+        std::string name = std::string("bestFit = smallest-hole scan, ") + layoutName(layout);
+        for (unsigned int seed = 1; seed <= 3; seed++) {
+            MemoryManager scan(8, scanBestFit), indexed(8, bestFit);
+            scan.initialize(20000, layout);
+            indexed.initialize(20000, layout);
+            replay({ &scan, &indexed }, seed, 20000, Mix{ false, true, false }, name);
+        }
+        report(name, failuresBefore);
+
+        failuresBefore = failures;
+        name = std::string("worstFit and the WorstFit engine = largest-hole scan, ") + layoutName(layout);
+        for (unsigned int seed = 1; seed <= 3; seed++) {
+            MemoryManager scan(8, scanWorstFit), indexed(8, worstFit), heap(8, Engine::WorstFit);
+            scan.initialize(20000, layout);
+            indexed.initialize(20000, layout);
+            heap.initialize(20000, layout);
+            replay({ &scan, &indexed, &heap }, seed, 20000, Mix{ false, true, false }, name);
+        }
+        report(name, failuresBefore);
+    }
+
+    // The hole list is only address-sorted out of band, where firstFit takes the lowest-addressed hole
+    size_t failuresBefore = failures;
+    std::string name = "firstFit = Bitmap engine, out-of-band";
+    for (unsigned int seed = 1; seed <= 3; seed++) {
+        MemoryManager scan(8, firstFit), bitmap(8, Engine::Bitmap);
+        scan.initialize(20000);
+        bitmap.initialize(20000);
+        replay({ &scan, &bitmap }, seed, 20000, Mix{ false, true, false }, name);
+    }
+    report(name, failuresBefore);
+}
+
+// Size indexes
+
+static void checkSizeIndex() {
+    std::cout << "Equivalence: hole table against size tree\n";
+
+    struct Case {
+        const char* name;
+        MemoryManager::Strategy strategy;
+    };
+
+    const Case cases[] = {
+        { "bestFit", bestFit },
+        { "worstFit", worstFit },
+    };
+
+    for (const Case& c : cases) {
+        for (Layout layout : { Layout::OutOfBand, Layout::BoundaryTags }) {
+            std::string name = std::string(c.name) + " on SizeIndex::Table = SizeIndex::Tree, " + layoutName(layout);
+            size_t failuresBefore = failures;
+
+            for (unsigned int seed = 1; seed <= 3; seed++) {
+                // Aligned requests go through the bounded probe, which the table replays
+                MemoryManager tree(8, c.strategy), table(8, c.strategy);
+                table.setSizeIndex(MemoryManager::SizeIndex::Table);
+                tree.initialize(20000, layout);
+                table.initialize(20000, layout);
+                replay({ &tree, &table }, seed, 20000, Mix{ true, true, false }, name);
+
+                // Indexes rebuilt from the hole list in the middle of a run
+                MemoryManager first(8, c.strategy), second(8, c.strategy);
+                first.initialize(20000, layout);
+                second.initialize(20000, layout);
+                replay({ &first, &second }, seed, 20000, Mix{ true, true, true }, name + ", switching");
+            }
+
+            report(name, failuresBefore);
+        }
+    }
+
+    // Engines without a size index must keep their own index across a switch
+    struct EngineCase {
+        const char* name;
+        Engine engine;
+    };
+
+    const EngineCase engines[] = {
+        { "TLSF", Engine::TLSF },
+        { "WorstFit", Engine::WorstFit },
+    };
+
+    for (const EngineCase& c : engines) {
+        for (Layout layout : { Layout::OutOfBand, Layout::BoundaryTags }) {
+            std::string name = std::string(c.name) + " engine unchanged by setSizeIndex, " + layoutName(layout);
+            size_t failuresBefore = failures;
+
+            for (unsigned int seed = 1; seed <= 3; seed++) {
+                MemoryManager fixed(8, c.engine), switching(8, c.engine);
+                fixed.initialize(20000, layout);
+                switching.initialize(20000, layout);
+                replay({ &fixed, &switching }, seed, 20000, Mix{ true, true, true }, name);
+            }
+
+            report(name, failuresBefore);
+        }
+    }
+}
+
+// Next fit
+
+// Address-ordered holes with a rover, kept apart from the manager's own bookkeeping.
+// The rover names the hole the last block came from, follows that hole when its start
+// moves, passes to the next hole when it is used up or to the left neighbour when a
+// free merges it away, and starts out past the last hole.
+class NextFitModel {
+public:
+    explicit NextFitModel(uint64_t words) {
+        holes[0] = words;
+        rover = holes.end();
+    }
+
+    // Offset of the block placed, -1 if no hole fits
+    int64_t allocate(uint64_t length) {
+        auto hole = firstFitFrom(rover, holes.end(), length);
+        if (hole == holes.end()) {
+            hole = firstFitFrom(holes.begin(), rover, length);
+        }
+        if (hole == holes.end()) {
+            return -1;
+        }
+
+        uint64_t offset = hole->first;
+        uint64_t remaining = hole->second - length;
+        auto next = holes.erase(hole);
+        rover = remaining == 0 ? next : holes.emplace_hint(next, offset + length, remaining);
+        return static_cast<int64_t>(offset);
+    }
+
+    void free(uint64_t offset, uint64_t length) {
+        auto right = holes.find(offset + length);
+        auto left = holes.lower_bound(offset);
+        if (left != holes.begin() && std::prev(left)->first + std::prev(left)->second == offset) {
+            left = std::prev(left);
+        } else {
+            left = holes.end();
+        }
+
+        if (left != holes.end() && right != holes.end()) {
+            left->second += length + right->second;
+            if (rover == right) {
+                rover = left;
+            }
+            holes.erase(right);
+        } else if (left != holes.end()) {
+            left->second += length;
+        } else if (right != holes.end()) {
+            // The hole now starts at the freed block; a rover on it stays on it
+            uint64_t merged = length + right->second;
+            bool onRight = rover == right;
+            auto next = holes.erase(right);
+            auto hole = holes.emplace_hint(next, offset, merged);
+            if (onRight) {
+                rover = hole;
+            }
+        } else {
+            holes.emplace(offset, length);
+        }
+    }
+
+    const std::map<uint64_t, uint64_t>& list() const { return holes; }
+
+private:
+    std::map<uint64_t, uint64_t> holes;     // Offset to length
+    std::map<uint64_t, uint64_t>::iterator rover;
+
+    std::map<uint64_t, uint64_t>::iterator firstFitFrom(std::map<uint64_t, uint64_t>::iterator first,
+                                                        std::map<uint64_t, uint64_t>::iterator last, uint64_t length) {
+        for (auto hole = first; hole != last; ++hole) {
+            if (hole->second >= length) {
+                return hole;
+            }
+        }
+        return holes.end();
+    }
+};
+
+static void checkNextFit() {
+    std::cout << "Equivalence: nextFit against an address-ordered model with a rover\n";
+
+    // The hole list is only address-sorted out of band, the order the model keeps
+    std::string name = "nextFit = model, out-of-band";
+    size_t failuresBefore = failures;
+    const uint64_t WORDS = 20000;
+
+    for (unsigned int seed = 1; seed <= 5; seed++) {
+        MemoryManager mm(8, nextFit);
+        mm.initialize(WORDS);
+        NextFitModel model(WORDS);
+
+        std::mt19937 rng(seed);
+        std::vector<std::pair<void*, uint64_t>> live;   // Block and its length in words
+
+        for (size_t step = 0; step < 20000 && failures == failuresBefore; step++) {
+            std::string at = name + " seed " + std::to_string(seed) + " step " + std::to_string(step);
+
+            if (live.empty() || rng() % 100 < 55) {
+                uint64_t length = 1 + rng() % 50;
+                void* block = mm.allocate(length * 8);
+                int64_t expected = model.allocate(length);
+                if (!expect(offsetOf(mm, block) == expected, at + ": placed at " + std::to_string(offsetOf(mm, block)) + ", model " + std::to_string(expected))) {
+                    break;
+                }
+                if (block != nullptr) {
+                    live.push_back({ block, length });
+                }
+            } else {
+                size_t index = rng() % live.size();
+                model.free(static_cast<uint64_t>(offsetOf(mm, live[index].first)), live[index].second);
+                mm.free(live[index].first);
+                live[index] = live.back();
+                live.pop_back();
+            }
+
+            if (step % 64 == 0) {
+                auto holes = holesOf(mm);
+                std::vector<std::pair<uint64_t, uint64_t>> expected(model.list().begin(), model.list().end());
+                expect(holes == expected, at + ": holes differ from the model");
+            }
+        }
+    }
+
+    report(name, failuresBefore);
+}
+
+// Segmented pools
+
+static void checkSegments() {
+    std::cout << "Segments: failed requests leave no segment behind\n";
+
+    for (Layout layout : { Layout::OutOfBand, Layout::BoundaryTags }) {
+        std::string name = std::string("impossible requests, ") + layoutName(layout);
+        size_t failuresBefore = failures;
+
+        MemoryManager mm(8, bestFit);
+        mm.initializeSegmented(4096, layout);
+
+        // Sizes whose word count used to overflow, then ones no segment can hold or align
+        const size_t sizes[] = { SIZE_MAX, SIZE_MAX - 7, SIZE_MAX / 8 + 1, size_t(MemoryManager::MAX_WIDE_NUM_WORDS) * 8 };
+        for (size_t size : sizes) {
+            expect(mm.allocate(size) == nullptr, name + ": allocate(" + std::to_string(size) + ") succeeded");
+        }
+        expect(mm.allocateAligned(64, size_t(1) << 40) == nullptr, name + ": allocateAligned(64, 2^40) succeeded");
+        expect(mm.getSegmentCount() == 1, name + ": " + std::to_string(mm.getSegmentCount()) + " segments after failed requests");
+
+        // A request larger than a default segment still gets one sized for it, released again on free
+        void* large = mm.allocate(64 * 1024);
+        expect(large != nullptr && mm.getSegmentCount() == 2, name + ": oversized request not served by a new segment");
+        mm.free(large);
+        expect(mm.getSegmentCount() == 1, name + ": oversized segment kept after free");
+
+        report(name, failuresBefore);
+    }
+}
+
+// Scavenger
+
+static void checkScavenger() {
+    std::cout << "Scavenger: release policy switched while it runs\n";
+
+    std::string name = "Advice::None stops releases from a running scavenger";
+    size_t failuresBefore = failures;
+    const size_t WORDS = size_t(16) << 20 >> 3;   // 16 MiB of 8-byte words
+
+    MemoryManager::ReleasePolicy policy;
+    policy.advice = MemoryManager::ReleasePolicy::Advice::DontNeed;
+    policy.minReleaseBytes = 0;
+
+    MemoryManager::ScavengerConfig config;
+    config.interval = std::chrono::milliseconds(5);
+    config.idleTime = std::chrono::milliseconds(10);
+
+    MemoryManager mm(8, bestFit);
+    mm.setReleasePolicy(policy);
+    mm.initialize(WORDS);
+    mm.startScavenger(config);
+
+    policy.advice = MemoryManager::ReleasePolicy::Advice::None;
+    mm.setReleasePolicy(policy);
+
+    // One large hole left idle for many passes, its contents must survive
+    void* block = mm.allocate(WORDS * 8);
+    std::memset(block, 0xA5, WORDS * 8);
+    mm.free(block);
+    std::this_thread::sleep_for(config.idleTime + 20 * config.interval);
+    mm.stopScavenger();
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(block);
+    bool kept = std::all_of(bytes, bytes + WORDS * 8, [](uint8_t b) { return b == 0xA5; });
+    expect(mm.getDecommittedBytes() == 0 && mm.getScavengerStats().bytesReleased == 0, name + ": hole released");
+    expect(kept, name + ": freed pages zeroed");
+
+    report(name, failuresBefore);
+}
+
+// Legacy strategies
+
+// First hole that fits, on the '[count, offset, length, ...]' array
+static int legacyFirstFit(int sizeInWords, void* list) {
+    const uint16_t* entries = static_cast<const uint16_t*>(list);
+    for (uint16_t i = 0; i < entries[0]; i++) {
+        if (entries[2 + 2 * i] >= sizeInWords) {
+            return entries[1 + 2 * i];
+        }
+    }
+    return -1;
+}
+
+// Throws 'std::invalid_argument' from 'call', nothing else
+template <typename Call>
+static bool rejects(Call call) {
+    try {
+        call();
+    } catch (const std::invalid_argument&) {
+        return true;
+    } catch (...) {
+        return false;
+    }
+    return false;
+}
+
+static void checkLegacy() {
+    std::cout << "Legacy strategies: wide pools rejected before any placement\n";
+
+    std::string name = "legacy strategy on pools beyond 65535 words";
+    size_t failuresBefore = failures;
+    const size_t WIDE = size_t(MemoryManager::MAX_NUM_WORDS) + 1;
+
+    MemoryManager legacy(8, legacyFirstFit);
+    expect(rejects([&] { legacy.initialize(WIDE); }), name + ": initialize accepted");
+    expect(rejects([&] { legacy.initializeGrowable(0, WIDE); }), name + ": initializeGrowable accepted");
+    expect(rejects([&] { legacy.initializeSegmented(WIDE); }), name + ": initializeSegmented accepted");
+
+    MemoryManager wide(8, bestFit);
+    wide.initialize(WIDE);
+    expect(rejects([&] { wide.setAllocator(legacyFirstFit); }), name + ": setAllocator accepted");
+    expect(wide.allocate(64) != nullptr, name + ": rejected setAllocator left the pool unusable");
+
+    // Segments chained for large requests stay within the compact format, the request fails instead
+    MemoryManager segmented(8, legacyFirstFit);
+    segmented.initializeSegmented(4096);
+    expect(segmented.allocate(WIDE * 8) == nullptr && segmented.getSegmentCount() == 1, name + ": wide segment chained");
+    expect(segmented.allocate(64) != nullptr, name + ": compact segment not usable");
+
+    report(name, failuresBefore);
+}
+
+int main(int argc, char** argv) {
+    struct Check {
+        const char* name;
+        void (*run)();
+    };
+
+    const Check checks[] = {
+        { "engines", checkEngines },
+        { "strategies", checkStrategies },
+        { "sizeindex", checkSizeIndex },
+        { "nextfit", checkNextFit },
+        { "segments", checkSegments },
+        { "scavenger", checkScavenger },
+        { "legacy", checkLegacy },
+    };
+
+    // Run the named checks, or all of them
+    for (const Check& check : checks) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; i++) {
+            selected = selected || std::strcmp(argv[i], check.name) == 0;
+        }
+
+        if (selected) {
+            check.run();
+        }
+    }
+
+    std::cout << (failures == 0 ? "All checks passed\n" : std::to_string(failures) + " failures\n");
+    return failures == 0 ? 0 : 1;
+}
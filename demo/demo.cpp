@@ -145,6 +145,28 @@ int main() {
     
     mm4.shutdown();
     
+    // Demo 5: TLSF engine
+    printSeparator("Demo 5: TLSF Engine");
+    
+    MemoryManager mm5(WORD_SIZE, MemoryManager::Engine::TLSF);
+    mm5.initialize(POOL_SIZE);
+    
+    void* t1 = mm5.allocate(32);  // 4 words
+    void* t2 = mm5.allocate(64);  // 8 words
+    mm5.allocate(16);             // 2 words
+    mm5.free(t2);
+    
+    std::cout << "\nSame setup: freed middle 8-word block\n";
+    printHoleList(mm5);
+    
+    std::cout << "\nAllocating 24 bytes (3 words) - TLSF picks a hole from the first size class that fits...\n";
+    void* t4 = mm5.allocate(24);
+    std::cout << "  Block address: " << t4 << "\n";
+    printHoleList(mm5);
+    
+    mm5.free(t1);
+    mm5.shutdown();
+    
     printSeparator("Demo Complete");
     
     return 0;
@@ -0,0 +1,390 @@
+#include <algorithm>
+#include <cstring>
+#include "AllocationBitmap.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ALLOCATION_BITMAP_X86
+#endif
+
+// Word skipping kernels: return the first index in [index, count) whose word is not 'pattern'
+
+static size_t skipScalar(const uint64_t* words, size_t index, size_t count, uint64_t pattern) {
+    while (index < count && words[index] == pattern) {
+        ++index;
+    }
+    return index;
+}
+
+#ifdef ALLOCATION_BITMAP_X86
+
+__attribute__((target("avx2")))
+static size_t skipAvx2(const uint64_t* words, size_t index, size_t count, uint64_t pattern) {
+    const __m256i expected = _mm256_set1_epi64x(static_cast<long long>(pattern));
+
+    // Four words per compare
+    while (index + 4 <= count) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + index));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi64(block, expected)) != -1) {
+            break;
+        }
+        index += 4;
+    }
+
+    return skipScalar(words, index, count, pattern);
+}
+
+__attribute__((target("sse2")))
+static size_t skipSse2(const uint64_t* words, size_t index, size_t count, uint64_t pattern) {
+    const __m128i expected = _mm_set1_epi64x(static_cast<long long>(pattern));
+
+    // Two words per compare
+    while (index + 2 <= count) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + index));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(block, expected)) != 0xFFFF) {
+            break;
+        }
+        index += 2;
+    }
+
+    return skipScalar(words, index, count, pattern);
+}
+
+#endif
+
+using SkipKernel = size_t (*)(const uint64_t*, size_t, size_t, uint64_t);
+
+static SkipKernel selectSkipKernel() {
+#ifdef ALLOCATION_BITMAP_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return skipAvx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return skipSse2;
+    }
+#endif
+    return skipScalar;
+}
+
+static const SkipKernel skipWords = selectSkipKernel();
+
+// Returns the first bit of a run of 'length' (at most 64) free bits inside 'word', or 64
+static size_t runInWord(uint64_t word, size_t length) {
+    // Bit i survives iff bits i .. i + length - 1 are free
+    uint64_t runs = ~word;
+    for (size_t covered = 1; covered < length && runs != 0; ) {
+        size_t step = std::min(covered, length - covered);
+        runs &= runs >> step;
+        covered += step;
+    }
+
+    return runs != 0 ? __builtin_ctzll(runs) : 64;
+}
+
+static uint8_t longestRunInWord(uint64_t word) {
+    if (word == 0) {
+        return 64;
+    }
+
+    // Walk the free runs, at most 32 per word
+    uint64_t free = ~word;
+    unsigned int longest = 0;
+    while (free != 0) {
+        free >>= __builtin_ctzll(free);
+        unsigned int run = __builtin_ctzll(~free);
+        longest = std::max(longest, run);
+        free >>= run;
+    }
+
+    return static_cast<uint8_t>(longest);
+}
+
+// AllocationBitmap
+
+void AllocationBitmap::assign(size_t numBits, bool searchable) {
+    this->numBits = 0;
+    this->searchable = searchable;
+    words.clear();
+
+    resize(numBits);
+}
+
+void AllocationBitmap::resize(size_t numBits) {
+    size_t oldBits = this->numBits;
+    this->numBits = numBits;
+
+    // Padding bits read as allocated so searches stop at 'numBits'
+    size_t count = ((numBits + 63) / 64 + 3) / 4 * 4;
+    words.resize(count, ~uint64_t(0));
+
+    // The node count changes, so summaries are rebuilt once the new bits are clear
+    wordLongest.clear();
+    levels.clear();
+    clearRange(oldBits, numBits - oldBits);
+
+    // Small bitmaps are scanned flat
+    if (searchable && count > SUMMARY_FANOUT) {
+        wordLongest.assign(count, 0);
+
+        size_t nodes = count;
+        do {
+            nodes = (nodes + SUMMARY_FANOUT - 1) / SUMMARY_FANOUT;
+            levels.emplace_back(nodes, Summary{ 0, 0, 0 });
+        } while (nodes > SUMMARY_FANOUT);
+
+        refresh(0, count - 1);
+    }
+}
+
+void AllocationBitmap::clear() {
+    numBits = 0;
+    words.clear();
+    words.shrink_to_fit();
+    wordLongest.clear();
+    wordLongest.shrink_to_fit();
+    levels.clear();
+    levels.shrink_to_fit();
+}
+
+void AllocationBitmap::setRange(size_t offset, size_t length) {
+    if (length == 0) {
+        return;
+    }
+
+    size_t first = offset / 64;
+    size_t last = (offset + length - 1) / 64;
+    uint64_t head = ~uint64_t(0) << (offset % 64);
+    uint64_t tail = ~uint64_t(0) >> (63 - (offset + length - 1) % 64);
+
+    if (first == last) {
+        words[first] |= head & tail;
+    } else {
+        words[first] |= head;
+        std::fill(words.begin() + first + 1, words.begin() + last, ~uint64_t(0));
+        words[last] |= tail;
+    }
+
+    refresh(first, last);
+}
+
+void AllocationBitmap::clearRange(size_t offset, size_t length) {
+    if (length == 0) {
+        return;
+    }
+
+    size_t first = offset / 64;
+    size_t last = (offset + length - 1) / 64;
+    uint64_t head = ~uint64_t(0) << (offset % 64);
+    uint64_t tail = ~uint64_t(0) >> (63 - (offset + length - 1) % 64);
+
+    if (first == last) {
+        words[first] &= ~(head & tail);
+    } else {
+        words[first] &= ~head;
+        std::fill(words.begin() + first + 1, words.begin() + last, uint64_t(0));
+        words[last] &= ~tail;
+    }
+
+    refresh(first, last);
+}
+
+size_t AllocationBitmap::count(size_t offset, size_t length) const {
+    if (length == 0) {
+        return 0;
+    }
+
+    size_t first = offset / 64;
+    size_t last = (offset + length - 1) / 64;
+    uint64_t head = ~uint64_t(0) << (offset % 64);
+    uint64_t tail = ~uint64_t(0) >> (63 - (offset + length - 1) % 64);
+
+    if (first == last) {
+        return __builtin_popcountll(words[first] & head & tail);
+    }
+
+    size_t total = __builtin_popcountll(words[first] & head) + __builtin_popcountll(words[last] & tail);
+    for (size_t index = first + 1; index < last; ++index) {
+        total += __builtin_popcountll(words[index]);
+    }
+
+    return total;
+}
+
+void AllocationBitmap::copyBytes(uint8_t* destination) const {
+    size_t numBytes = (numBits + 7) / 8;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Little-endian words already are the byte image
+    std::memcpy(destination, words.data(), numBytes);
+#else
+    for (size_t byte = 0; byte < numBytes; ++byte) {
+        destination[byte] = static_cast<uint8_t>(words[byte / 8] >> (byte % 8 * 8));
+    }
+#endif
+
+    // Padding bits past the end read as allocated here, but not in the copy
+    if (numBits % 8 != 0) {
+        destination[numBytes - 1] &= static_cast<uint8_t>((1u << (numBits % 8)) - 1);
+    }
+}
+
+size_t AllocationBitmap::findFreeRun(size_t length) const {
+    if (levels.empty()) {
+        return scanWords(length);
+    }
+
+    // Children of a virtual root are the top-level nodes
+    return searchLevel(levels.size(), 0, levels.back().size(), length);
+}
+
+size_t AllocationBitmap::scanWords(size_t length) const {
+    size_t count = words.size();
+    size_t carry = 0;   // Free bits at the top of the previous word
+
+    for (size_t index = 0; index < count; ++index) {
+        uint64_t word = words[index];
+
+        // Fully allocated stretches end any run, skip them in bulk
+        if (word == ~uint64_t(0)) {
+            carry = 0;
+            index = skipWords(words.data(), index + 1, count, ~uint64_t(0)) - 1;
+            continue;
+        }
+
+        if (word == 0) {
+            carry += 64;
+            if (carry >= length) {
+                return (index + 1) * 64 - carry;
+            }
+            continue;
+        }
+
+        // Run carried in from the previous words, extended by the free low bits
+        if (carry + __builtin_ctzll(word) >= length) {
+            return index * 64 - carry;
+        }
+
+        if (length <= 64) {
+            size_t bit = runInWord(word, length);
+            if (bit < 64) {
+                return index * 64 + bit;
+            }
+        }
+
+        carry = __builtin_clzll(word);
+    }
+
+    return NOT_FOUND;
+}
+
+// Searches children [first, last) of the nodes at 'level'; level 0 children are words
+size_t AllocationBitmap::searchLevel(size_t level, size_t first, size_t last, size_t length) const {
+    size_t span = childSpan(level);
+    size_t carry = 0;
+
+    for (size_t index = first; index < last; ++index) {
+        Summary child = childSummary(level, index);
+
+        // Run crossing in from the previous children
+        if (carry + child.prefix >= length) {
+            return index * span - carry;
+        }
+
+        // Run inside this child, the leftmost one is earlier than any crossing out of it
+        if (child.longest >= length) {
+            if (level == 0) {
+                return index * 64 + runInWord(words[index], length);
+            }
+
+            size_t below = level == 1 ? words.size() : levels[level - 2].size();
+            size_t begin = index * SUMMARY_FANOUT;
+            return searchLevel(level - 1, begin, std::min(begin + SUMMARY_FANOUT, below), length);
+        }
+
+        carry = child.prefix == span ? carry + span : child.suffix;
+    }
+
+    return NOT_FOUND;
+}
+
+AllocationBitmap::Summary AllocationBitmap::childSummary(size_t level, size_t index) const {
+    if (level > 0) {
+        return levels[level - 1][index];
+    }
+
+    uint64_t word = words[index];
+    if (word == 0) {
+        return Summary{ 64, 64, 64 };
+    }
+
+    return Summary{
+        static_cast<uint64_t>(__builtin_ctzll(word)),
+        static_cast<uint64_t>(__builtin_clzll(word)),
+        wordLongest[index]
+    };
+}
+
+size_t AllocationBitmap::childSpan(size_t level) const {
+    size_t span = 64;
+    for (size_t l = 0; l < level; ++l) {
+        span *= SUMMARY_FANOUT;
+    }
+    return span;
+}
+
+void AllocationBitmap::refresh(size_t firstWord, size_t lastWord) {
+    if (levels.empty()) {
+        return;
+    }
+
+    for (size_t index = firstWord; index <= lastWord; ++index) {
+        wordLongest[index] = longestRunInWord(words[index]);
+    }
+
+    // Recombine the touched nodes level by level
+    size_t first = firstWord / SUMMARY_FANOUT;
+    size_t last = lastWord / SUMMARY_FANOUT;
+
+    for (size_t level = 0; level < levels.size(); ++level) {
+        size_t span = childSpan(level);
+        size_t children = level == 0 ? words.size() : levels[level - 1].size();
+
+        for (size_t node = first; node <= last; ++node) {
+            size_t begin = node * SUMMARY_FANOUT;
+            size_t end = std::min(begin + SUMMARY_FANOUT, children);
+
+            Summary summary = { 0, 0, 0 };
+            uint64_t carry = 0;
+            bool allFree = true;
+
+            for (size_t index = begin; index < end; ++index) {
+                Summary child = childSummary(level, index);
+
+                if (child.prefix == span) {
+                    carry += span;
+                    if (allFree) {
+                        summary.prefix += span;
+                    }
+                    continue;
+                }
+
+                if (allFree) {
+                    summary.prefix += child.prefix;
+                    allFree = false;
+                }
+
+                summary.longest = std::max({ summary.longest, carry + child.prefix, child.longest });
+                carry = child.suffix;
+            }
+
+            // Missing children lie past the bitmap and count as allocated
+            summary.longest = std::max(summary.longest, carry);
+            summary.suffix = end - begin == SUMMARY_FANOUT ? carry : 0;
+
+            levels[level][node] = summary;
+        }
+
+        first /= SUMMARY_FANOUT;
+        last /= SUMMARY_FANOUT;
+    }
+}
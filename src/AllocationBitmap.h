@@ -0,0 +1,68 @@
+#ifndef ALLOCATION_BITMAP_H
+#define ALLOCATION_BITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Word-granular allocation bitmap stored in 64-bit words, 1 = allocated.
+//
+// Ranges are set and cleared with masked whole-word writes. Free-run search skips
+// fully allocated stretches with AVX2/SSE2 when the CPU supports it, carries runs
+// across word boundaries with count-leading/trailing-zeros, and finds runs inside
+// a word with a logarithmic shift-and reduction instead of visiting each run.
+//
+// Bitmaps longer than SUMMARY_FANOUT words also keep a summary hierarchy: the
+// longest free run of every word, then free prefix/suffix/longest run of every
+// group of 64 words, of every group of 64 groups, and so on up to a level of at
+// most 64 nodes. Searches descend only into nodes that can hold the run, and
+// updates refresh just the touched nodes on each level.
+class AllocationBitmap {
+public:
+    static const size_t NOT_FOUND = static_cast<size_t>(-1);
+    static const size_t SUMMARY_FANOUT = 64;
+
+    // Summaries are only kept when 'searchable', otherwise searches scan the words
+    void assign(size_t numBits, bool searchable = true);
+
+    // Grows to 'numBits', keeping existing bits; new bits start free
+    void resize(size_t numBits);
+    void clear();
+
+    void setRange(size_t offset, size_t length);
+    void clearRange(size_t offset, size_t length);
+
+    // Number of set bits in [offset, offset + length)
+    size_t count(size_t offset, size_t length) const;
+
+    // Returns the start of the first run of at least 'length' free bits, or NOT_FOUND
+    size_t findFreeRun(size_t length) const;
+
+    // Copies the bitmap as (size() + 7) / 8 bytes, bit i of the bitmap at bit i % 8 of byte i / 8
+    void copyBytes(uint8_t* destination) const;
+
+    size_t size() const { return numBits; }
+    const uint64_t* data() const { return words.data(); }
+
+private:
+    // Free bits at the low end, at the high end, and longest run of a node
+    struct Summary {
+        uint64_t prefix;
+        uint64_t suffix;
+        uint64_t longest;
+    };
+
+    size_t numBits = 0;
+    bool searchable = true;
+    std::vector<uint64_t> words;                // Padded to a multiple of 4 words, padding bits set
+    std::vector<uint8_t> wordLongest;           // Longest free run per word
+    std::vector<std::vector<Summary>> levels;   // levels[0] summarizes 64 words, each next level 64 nodes below
+
+    size_t scanWords(size_t length) const;
+    size_t searchLevel(size_t level, size_t first, size_t last, size_t length) const;
+    Summary childSummary(size_t level, size_t index) const;
+    size_t childSpan(size_t level) const;
+    void refresh(size_t firstWord, size_t lastWord);
+};
+
+#endif // ALLOCATION_BITMAP_H
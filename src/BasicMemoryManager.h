@@ -0,0 +1,104 @@
+#ifndef BASIC_MEMORY_MANAGER_H
+#define BASIC_MEMORY_MANAGER_H
+
+#include <algorithm>
+#include "MemoryManager.h"
+
+// Strategy policies: a static 'select' with the Strategy signature, inlined by BasicMemoryManager
+
+struct BestFitPolicy {
+    // Smallest suitable hole, lowest offset on ties
+    static MemoryManager::HoleView::const_iterator select(unsigned int sizeInWords, const MemoryManager::HoleView& holes) {
+        return holes.smallestAtLeast(sizeInWords);
+    }
+};
+
+struct WorstFitPolicy {
+    // Largest hole, lowest offset on ties
+    static MemoryManager::HoleView::const_iterator select(unsigned int sizeInWords, const MemoryManager::HoleView& holes) {
+        auto largest = holes.largest();
+        return largest == holes.end() || largest->length < sizeInWords ? holes.end() : largest;
+    }
+};
+
+struct FirstFitPolicy {
+    // First suitable hole in list order
+    static MemoryManager::HoleView::const_iterator select(unsigned int sizeInWords, const MemoryManager::HoleView& holes) {
+        return firstFit(static_cast<int>(sizeInWords), holes);
+    }
+};
+
+struct NextFitPolicy {
+    // First suitable hole from the rover on, wrapping around
+    static MemoryManager::HoleView::const_iterator select(unsigned int sizeInWords, const MemoryManager::HoleView& holes) {
+        return nextFit(static_cast<int>(sizeInWords), holes);
+    }
+};
+
+// Strategy engine with the strategy and word size fixed at compile time.
+//
+// 'allocate' calls 'Policy::select' directly instead of through a std::function, and
+// divides by a constant word size. Everything else is the MemoryManager it derives
+// from, which runs the same policy through its runtime Strategy hook: segmented pools,
+// large blocks, aligned requests and calls through a MemoryManager reference take that
+// path. 'setAllocator' is deleted so the two paths cannot diverge.
+template <typename Policy, unsigned int WordSize>
+class BasicMemoryManager : public MemoryManager {
+public:
+    static_assert(WordSize > 0, "WordSize must be positive");
+
+    BasicMemoryManager()
+        : MemoryManager(WordSize, Strategy([](int sizeInWords, const HoleView& holes) {
+              return Policy::select(static_cast<unsigned int>(sizeInWords), holes);
+          })) {}
+
+    void* allocate(size_t sizeInBytes) {
+        return allocateWith<WordSize>(sizeInBytes, Policy::select);
+    }
+
+    // The policy is fixed: a new strategy would only reach the runtime path, not 'allocate'
+    void setAllocator(Strategy allocator) = delete;
+    void setAllocator(LegacyStrategy allocator) = delete;
+    void setAllocator(WideListStrategy allocator) = delete;
+};
+
+template <unsigned int WordSize, typename Select>
+void* MemoryManager::allocateWith(size_t sizeInBytes, Select select) {
+    auto lock = lockAllocator();
+
+    // Segments, large blocks and requests the pool cannot hold take the runtime path
+    if (segmentWords != 0 || memoryStart == nullptr || sizeInBytes == 0 || sizeInBytes > reservedLimit ||
+        (largeBlockThreshold != 0 && sizeInBytes >= largeBlockThreshold)) {
+        return allocateBytes(sizeInBytes, 0);
+    }
+
+    size_t requestedWords = (sizeInBytes + WordSize - 1) / WordSize;   // Constant divisor
+
+    // Boundary tags travel with the block
+    if (layout == Layout::BoundaryTags) {
+        requestedWords = std::max<size_t>(requestedWords + 2 * tagWords, minBlockWords);
+        if (requestedWords > reservedLimit / WordSize) {
+            return nullptr;
+        }
+    }
+
+    unsigned int sizeInWords = static_cast<unsigned int>(requestedWords);
+
+    // Growable pools commit more of their reservation and retry once
+    auto hole = select(sizeInWords, HoleView(*this));
+    if (hole == holeList.end()) {
+        if (!grow(sizeInWords)) {
+            return nullptr;
+        }
+
+        hole = select(sizeInWords, HoleView(*this));
+        if (hole == holeList.end()) {
+            return nullptr;
+        }
+    }
+
+    // Empty erase turns the read-only handle back into a mutable one
+    return allocateFromHole(holeList.erase(hole, hole), sizeInWords);
+}
+
+#endif // BASIC_MEMORY_MANAGER_H
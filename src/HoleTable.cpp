@@ -0,0 +1,224 @@
+#include <algorithm>
+#include "HoleTable.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HOLE_TABLE_X86
+#endif
+
+// Fit kernels over 'count' entries: return the chosen entry or NOT_FOUND.
+// Candidates are compared as (length, offset) pairs, the offset settling ties.
+
+static bool smaller(uint32_t length, uint32_t offset, uint32_t bestLength, uint32_t bestOffset) {
+    return length != bestLength ? length < bestLength : offset < bestOffset;
+}
+
+static bool larger(uint32_t length, uint32_t offset, uint32_t bestLength, uint32_t bestOffset) {
+    return length != bestLength ? length > bestLength : offset < bestOffset;
+}
+
+static size_t smallestScalar(const uint32_t* lengths, const uint32_t* offsets, size_t count, uint32_t length) {
+    size_t best = HoleTableArrays::NOT_FOUND;
+    for (size_t entry = 0; entry < count; ++entry) {
+        if (lengths[entry] >= length
+            && (best == HoleTableArrays::NOT_FOUND || smaller(lengths[entry], offsets[entry], lengths[best], offsets[best]))) {
+            best = entry;
+        }
+    }
+    return best;
+}
+
+static size_t largestScalar(const uint32_t* lengths, const uint32_t* offsets, size_t count) {
+    size_t best = HoleTableArrays::NOT_FOUND;
+    for (size_t entry = 0; entry < count; ++entry) {
+        if (best == HoleTableArrays::NOT_FOUND || larger(lengths[entry], offsets[entry], lengths[best], offsets[best])) {
+            best = entry;
+        }
+    }
+    return best;
+}
+
+#ifdef HOLE_TABLE_X86
+
+// The AVX2 kernels make separate passes so that each carries a single min or max
+// from one group of lanes to the next: the best length, then the lowest offset of
+// that length, then the entry holding that offset (offsets are unique). Two
+// accumulators per pass keep two groups in flight. Arrays are padded, so the
+// last partial group is read whole.
+
+__attribute__((target("avx2")))
+static inline __m256i load(const uint32_t* values, size_t entry) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + entry));
+}
+
+// Lanes of 'values' below 'length' set to UINT32_MAX
+__attribute__((target("avx2")))
+static inline __m256i atLeastOrNone(__m256i values, __m256i length) {
+    __m256i fits = _mm256_cmpeq_epi32(_mm256_max_epu32(values, length), values);
+    return _mm256_or_si256(values, _mm256_andnot_si256(fits, _mm256_set1_epi32(-1)));
+}
+
+// Lanes of 'offsets' whose length is not 'length' set to UINT32_MAX
+__attribute__((target("avx2")))
+static inline __m256i offsetsOfLength(__m256i offsets, __m256i lengths, __m256i length) {
+    return _mm256_or_si256(offsets, _mm256_andnot_si256(_mm256_cmpeq_epi32(lengths, length), _mm256_set1_epi32(-1)));
+}
+
+__attribute__((target("avx2")))
+static uint32_t lowestLane(__m256i lanes) {
+    alignas(32) uint32_t values[HoleTableArrays::LANES];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(values), lanes);
+    return *std::min_element(values, values + HoleTableArrays::LANES);
+}
+
+__attribute__((target("avx2")))
+static uint32_t highestLane(__m256i lanes) {
+    alignas(32) uint32_t values[HoleTableArrays::LANES];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(values), lanes);
+    return *std::max_element(values, values + HoleTableArrays::LANES);
+}
+
+// Lowest offset among entries exactly 'length' long, UINT32_MAX if none
+__attribute__((target("avx2")))
+static uint32_t lowestOffsetOfLength(const uint32_t* lengths, const uint32_t* offsets, size_t count, uint32_t length) {
+    const __m256i target = _mm256_set1_epi32(static_cast<int>(length));
+    __m256i low = _mm256_set1_epi32(-1);
+    __m256i high = low;
+
+    size_t entry = 0;
+    for (; entry + HoleTableArrays::LANES < count; entry += 2 * HoleTableArrays::LANES) {
+        low = _mm256_min_epu32(low, offsetsOfLength(load(offsets, entry), load(lengths, entry), target));
+        high = _mm256_min_epu32(high, offsetsOfLength(load(offsets, entry + HoleTableArrays::LANES), load(lengths, entry + HoleTableArrays::LANES), target));
+    }
+    if (entry < count) {
+        low = _mm256_min_epu32(low, offsetsOfLength(load(offsets, entry), load(lengths, entry), target));
+    }
+
+    return lowestLane(_mm256_min_epu32(low, high));
+}
+
+// Entry holding 'offset', which must be present
+__attribute__((target("avx2")))
+static size_t entryOf(const uint32_t* offsets, size_t count, uint32_t offset) {
+    const __m256i target = _mm256_set1_epi32(static_cast<int>(offset));
+
+    for (size_t entry = 0; entry < count; entry += HoleTableArrays::LANES) {
+        int matches = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(load(offsets, entry), target)));
+        if (matches != 0) {
+            return entry + __builtin_ctz(matches);
+        }
+    }
+
+    return HoleTableArrays::NOT_FOUND;
+}
+
+// Masked min-reduction over the lengths at least 'length'
+__attribute__((target("avx2")))
+static size_t smallestAvx2(const uint32_t* lengths, const uint32_t* offsets, size_t count, uint32_t length) {
+    const __m256i request = _mm256_set1_epi32(static_cast<int>(length));
+    __m256i low = _mm256_set1_epi32(-1);
+    __m256i high = low;
+
+    size_t entry = 0;
+    for (; entry + HoleTableArrays::LANES < count; entry += 2 * HoleTableArrays::LANES) {
+        low = _mm256_min_epu32(low, atLeastOrNone(load(lengths, entry), request));
+        high = _mm256_min_epu32(high, atLeastOrNone(load(lengths, entry + HoleTableArrays::LANES), request));
+    }
+    if (entry < count) {
+        low = _mm256_min_epu32(low, atLeastOrNone(load(lengths, entry), request));
+    }
+
+    // No fit leaves UINT32_MAX, which only a hole of that very length would match
+    uint32_t best = lowestLane(_mm256_min_epu32(low, high));
+    uint32_t offset = lowestOffsetOfLength(lengths, offsets, count, best);
+    return offset == UINT32_MAX ? HoleTableArrays::NOT_FOUND : entryOf(offsets, count, offset);
+}
+
+// Max-reduction over the lengths; padding lengths are 0
+__attribute__((target("avx2")))
+static size_t largestAvx2(const uint32_t* lengths, const uint32_t* offsets, size_t count) {
+    __m256i low = _mm256_setzero_si256();
+    __m256i high = low;
+
+    size_t entry = 0;
+    for (; entry + HoleTableArrays::LANES < count; entry += 2 * HoleTableArrays::LANES) {
+        low = _mm256_max_epu32(low, load(lengths, entry));
+        high = _mm256_max_epu32(high, load(lengths, entry + HoleTableArrays::LANES));
+    }
+    if (entry < count) {
+        low = _mm256_max_epu32(low, load(lengths, entry));
+    }
+
+    uint32_t best = highestLane(_mm256_max_epu32(low, high));
+    if (best == 0) {
+        return HoleTableArrays::NOT_FOUND;
+    }
+
+    return entryOf(offsets, count, lowestOffsetOfLength(lengths, offsets, count, best));
+}
+
+#endif
+
+using SmallestKernel = size_t (*)(const uint32_t*, const uint32_t*, size_t, uint32_t);
+using LargestKernel = size_t (*)(const uint32_t*, const uint32_t*, size_t);
+
+static SmallestKernel selectSmallestKernel() {
+#ifdef HOLE_TABLE_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return smallestAvx2;
+    }
+#endif
+    return smallestScalar;
+}
+
+static LargestKernel selectLargestKernel() {
+#ifdef HOLE_TABLE_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return largestAvx2;
+    }
+#endif
+    return largestScalar;
+}
+
+static const SmallestKernel smallestKernel = selectSmallestKernel();
+static const LargestKernel largestKernel = selectLargestKernel();
+
+// HoleTableArrays
+
+size_t HoleTableArrays::smallestAtLeast(uint32_t length) const {
+    // No hole is empty, and the padding must never qualify
+    return smallestKernel(lengths.data(), offsets.data(), count, length != 0 ? length : 1);
+}
+
+size_t HoleTableArrays::largest() const {
+    return largestKernel(lengths.data(), offsets.data(), count);
+}
+
+void HoleTableArrays::clearArrays() {
+    count = 0;
+    lengths.clear();
+    offsets.clear();
+}
+
+size_t HoleTableArrays::pushEntry(uint32_t offset, uint32_t length) {
+    // Grow a whole group of padding at a time
+    if (count == lengths.size()) {
+        lengths.resize(count + LANES, 0);
+        offsets.resize(count + LANES, UINT32_MAX);
+    }
+
+    lengths[count] = length;
+    offsets[count] = offset;
+    return count++;
+}
+
+void HoleTableArrays::moveEntry(size_t from, size_t to) {
+    lengths[to] = lengths[from];
+    offsets[to] = offsets[from];
+}
+
+void HoleTableArrays::popEntry() {
+    --count;
+    lengths[count] = 0;
+    offsets[count] = UINT32_MAX;
+}
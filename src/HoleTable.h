@@ -0,0 +1,82 @@
+#ifndef HOLE_TABLE_H
+#define HOLE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Structure-of-arrays hole table: lengths and offsets in separate contiguous
+// arrays, in no particular order, so fit searches stream eight 32-bit lanes per
+// AVX2 compare. Both arrays are padded to a multiple of 8 entries with
+// {length 0, offset UINT32_MAX}, which no search ever picks.
+//
+// Searches break ties by the lowest offset, so the chosen hole does not depend
+// on table order. The kernels are selected once from the CPU's features, with a
+// scalar fallback.
+class HoleTableArrays {
+public:
+    static const size_t NOT_FOUND = static_cast<size_t>(-1);
+    static const size_t LANES = 8;
+
+    // Entry of the smallest hole at least 'length' long, or NOT_FOUND
+    size_t smallestAtLeast(uint32_t length) const;
+
+    // Entry of the largest hole, or NOT_FOUND if empty
+    size_t largest() const;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+protected:
+    size_t count = 0;
+    std::vector<uint32_t> lengths;
+    std::vector<uint32_t> offsets;
+
+    void clearArrays();
+    size_t pushEntry(uint32_t offset, uint32_t length);
+    void moveEntry(size_t from, size_t to);
+    void popEntry();
+};
+
+// Hole table over handles of the manager's hole list.
+//
+// 'Handle' must dereference to a hole exposing 'offset', 'length' and 'slot'. The
+// table owns 'slot' (the handle's entry) while the handle is inserted; erasing
+// moves the last entry into the freed one.
+template <typename Handle>
+class HoleTable : public HoleTableArrays {
+public:
+    void clear() {
+        clearArrays();
+        handles.clear();
+    }
+
+    void insert(Handle handle) {
+        handle->slot = static_cast<unsigned int>(pushEntry(handle->offset, handle->length));
+        handles.push_back(handle);
+    }
+
+    // Must be called before the hole's offset or length changes
+    void erase(Handle handle) {
+        size_t entry = handle->slot;
+        size_t last = count - 1;
+
+        if (entry != last) {
+            moveEntry(last, entry);
+            handles[entry] = handles[last];
+            handles[entry]->slot = static_cast<unsigned int>(entry);
+        }
+
+        popEntry();
+        handles.pop_back();
+    }
+
+    Handle at(size_t entry) const {
+        return handles[entry];
+    }
+
+private:
+    std::vector<Handle> handles;
+};
+
+#endif // HOLE_TABLE_H
@@ -0,0 +1,95 @@
+#ifndef MAX_HEAP_H
+#define MAX_HEAP_H
+
+#include <cstddef>
+#include <vector>
+
+// Binary max-heap of holes ordered by length, lowest offset first on ties.
+//
+// 'Handle' must dereference to a hole exposing 'offset', 'length' and 'slot'. The
+// heap owns 'slot' (the handle's position in the heap array) while the handle is
+// inserted, which lets arbitrary holes be removed when they split or coalesce.
+template <typename Handle>
+class MaxHeap {
+public:
+    void clear() {
+        heap.clear();
+    }
+
+    bool empty() const {
+        return heap.empty();
+    }
+
+    // Largest hole, O(1)
+    Handle top() const {
+        return heap.front();
+    }
+
+    void insert(Handle handle) {
+        heap.push_back(handle);
+        handle->slot = static_cast<unsigned int>(heap.size() - 1);
+        siftUp(handle->slot);
+    }
+
+    // Must be called before the hole's offset or length changes
+    void erase(Handle handle) {
+        size_t index = handle->slot;
+        Handle last = heap.back();
+        heap.pop_back();
+
+        if (index == heap.size()) {
+            return;
+        }
+
+        place(index, last);
+        siftUp(index);
+        siftDown(last->slot);
+    }
+
+private:
+    std::vector<Handle> heap;
+
+    static bool before(Handle a, Handle b) {
+        return a->length != b->length ? a->length > b->length : a->offset < b->offset;
+    }
+
+    void place(size_t index, Handle handle) {
+        heap[index] = handle;
+        handle->slot = static_cast<unsigned int>(index);
+    }
+
+    void siftUp(size_t index) {
+        Handle handle = heap[index];
+        while (index > 0) {
+            size_t parent = (index - 1) / 2;
+            if (!before(handle, heap[parent])) {
+                break;
+            }
+            place(index, heap[parent]);
+            index = parent;
+        }
+        place(index, handle);
+    }
+
+    void siftDown(size_t index) {
+        Handle handle = heap[index];
+        size_t size = heap.size();
+        while (true) {
+            size_t child = 2 * index + 1;
+            if (child >= size) {
+                break;
+            }
+            if (child + 1 < size && before(heap[child + 1], heap[child])) {
+                ++child;
+            }
+            if (!before(heap[child], handle)) {
+                break;
+            }
+            place(index, heap[child]);
+            index = child;
+        }
+        place(index, handle);
+    }
+};
+
+#endif // MAX_HEAP_H
@@ -1,317 +1,1955 @@
+#include <algorithm>
+#include <climits>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <iterator>
+#include <memory>
+#include <numeric>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <vector>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
 #include "MemoryManager.h"
 
-MemoryManager::MemoryManager(unsigned int wordSize, std::function<int(int, void*)> allocator)
-    : wordSize(wordSize), memoryStart(nullptr), memoryLimit(0), allocator(allocator) {}
+static size_t basePageBytes() {
+    static const size_t bytes = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return bytes;
+}
+
+// Shift equivalent to dividing by 'wordSize', -1 if it is not a power of two
+static int shiftOf(unsigned int wordSize) {
+    return wordSize != 0 && (wordSize & (wordSize - 1)) == 0 ? __builtin_ctz(wordSize) : -1;
+}
+
+MemoryManager::MemoryManager(unsigned int wordSize, Strategy allocator)
+    : wordSize(wordSize), wordShift(shiftOf(wordSize)), memoryStart(nullptr), memoryLimit(0), reservedLimit(0), allocator(allocator), engine(Engine::Strategy),
+      layout(Layout::OutOfBand), tagWords(0), minBlockWords(1) {}
+
+MemoryManager::MemoryManager(unsigned int wordSize, LegacyStrategy allocator)
+    : MemoryManager(wordSize, adaptLegacy(allocator)) {
+    legacyAllocator = true;
+}
+
+MemoryManager::MemoryManager(unsigned int wordSize, WideListStrategy allocator)
+    : MemoryManager(wordSize, adaptWideList(allocator)) {}
+
+MemoryManager::MemoryManager(unsigned int wordSize, Engine engine)
+    : wordSize(wordSize), wordShift(shiftOf(wordSize)), memoryStart(nullptr), memoryLimit(0), reservedLimit(0), allocator(bestFit), engine(engine),
+      layout(Layout::OutOfBand), tagWords(0), minBlockWords(1) {}
 
 MemoryManager::~MemoryManager() {
     shutdown();
 }
 
+// Word arithmetic, shifts and masks for power-of-two word sizes
+
+size_t MemoryManager::wordsFloor(size_t bytes) const {
+    return wordShift >= 0 ? bytes >> wordShift : bytes / wordSize;
+}
+
+size_t MemoryManager::wordsCeil(size_t bytes) const {
+    return wordsFloor(bytes + wordSize - 1);
+}
+
+bool MemoryManager::isWordAligned(size_t bytes) const {
+    return wordShift >= 0 ? (bytes & (wordSize - 1)) == 0 : bytes % wordSize == 0;
+}
+
 // Core functionality
 
-void MemoryManager::initialize(size_t sizeInWords) {
+void MemoryManager::initialize(size_t sizeInWords, Layout layout) {
+    initializeGrowable(sizeInWords, sizeInWords, layout);
+}
+
+void MemoryManager::initializeGrowable(size_t sizeInWords, size_t reservedWords, Layout layout) {
     // Clean up existing memory
-    if (memoryStart != nullptr) {
-        shutdown();
+    shutdown();
+
+    // Validate 'sizeInWords' and 'reservedWords'
+    if (reservedWords == 0 || reservedWords > maxPoolWords()) {
+        throw std::invalid_argument(
+            "Expected reservedWords to be in range 1 to " + std::to_string(maxPoolWords()) + ", but got " + std::to_string(reservedWords)
+        );
+    }
+
+    if (sizeInWords > reservedWords) {
+        throw std::invalid_argument(
+            "Expected sizeInWords to be at most reservedWords (" + std::to_string(reservedWords) + "), but got " + std::to_string(sizeInWords)
+        );
     }
 
-    // Validate 'sizeInWords'
-    if (sizeInWords > MAX_NUM_WORDS) {
+    setLayout(layout);
+
+    // A growable pool may start with nothing committed, its first hole then comes from grow()
+    if (sizeInWords != 0 && sizeInWords < minBlockWords && layout == Layout::BoundaryTags) {
         throw std::invalid_argument(
-            "Expected sizeInWords to be in range 1 to 65535, but got " + std::to_string(sizeInWords)
+            "Expected sizeInWords to be 0 or at least " + std::to_string(minBlockWords) + " with boundary tags, but got " + std::to_string(sizeInWords)
         );
     }
 
     memoryLimit = sizeInWords * wordSize;
+    reservedLimit = reservedWords * wordSize;
 
     // Allocate memory using mmap
-    memoryStart = mmap(nullptr, memoryLimit, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-    if (memoryStart == MAP_FAILED) {
+    if (!mapPool()) {
         memoryLimit = 0;
-        memoryStart = nullptr;
+        reservedLimit = 0;
         throw std::runtime_error("Memory allocation failed during initialization.");
     }
 
     holeList.clear();
-    holeList.push_back(Hole{ 0, static_cast<unsigned int>(sizeInWords) });
-
+    rover = holeList.end();
+    clearTracking();
     allocatedList.clear();
+
+    // Every engine keeps the bitmap for getBitmap(), only the Bitmap engine searches it
+    allocationBitmap.assign(sizeInWords, engine == Engine::Bitmap);
+
+    // Nothing released yet
+    decommittedPages.assign(mappedBytes / pageBytes, false);
+    decommittedBytes = 0;
+
+    // Boundary tags replace the out-of-band tables, which cover the reservation so growing never moves them
+    if (layout == Layout::OutOfBand) {
+        if (!blockIndex.assign(reservedWords, allocatedList.end()) || !holeByStart.assign(reservedWords + 1, holeList.end())
+            || !holeByEnd.assign(reservedWords + 1, holeList.end())) {
+            shutdown();
+            throw std::runtime_error("Memory allocation failed during initialization.");
+        }
+        if (prefaultTables) {
+            commitTables(sizeInWords);
+        }
+        holeStarts.assign(sizeInWords);
+    }
+
+    if (sizeInWords != 0) {
+        insertHole(holeList.end(), 0, static_cast<unsigned int>(sizeInWords));
+    }
+}
+
+void MemoryManager::initializeSegmented(size_t segmentWords, Layout layout) {
+    // Clean up existing memory
+    shutdown();
+
+    // Validate 'segmentWords'
+    if (segmentWords == 0 || segmentWords > maxPoolWords()) {
+        throw std::invalid_argument(
+            "Expected segmentWords to be in range 1 to " + std::to_string(maxPoolWords()) + ", but got " + std::to_string(segmentWords)
+        );
+    }
+
+    setLayout(layout);
+
+    // Whole bytes of bitmap per segment, so segment bitmaps concatenate
+    this->segmentWords = std::min<size_t>((segmentWords + 7) / 8 * 8, maxPoolWords() / 8 * 8);
+    currentSegment = addSegment(this->segmentWords);
+}
+
+bool MemoryManager::mapPool() {
+    const size_t HUGE_PAGE_BYTES = size_t(2) << 20;
+    bool growable = reservedLimit != memoryLimit;
+
+    // Reserved huge pages, only for fixed pools: MAP_NORESERVE huge pages could fault with SIGBUS later
+    if (preferredPages == Pages::HugeTlb && !growable) {
+        mappedBytes = (reservedLimit + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+        memoryStart = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (memoryStart != MAP_FAILED) {
+            pages = Pages::HugeTlb;
+            pageBytes = HUGE_PAGE_BYTES;
+            return true;
+        }
+    }
+
+    // Growable pools only reserve address space past their committed head
+    int protection = growable ? PROT_NONE : PROT_READ | PROT_WRITE;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | (growable ? MAP_NORESERVE : 0);
+
+    pages = Pages::Standard;
+    pageBytes = basePageBytes();
+    memoryStart = MAP_FAILED;
+
+    if (preferredPages != Pages::Standard) {
+        // Over-map, then trim to a 2 MiB-aligned range so whole huge pages fit
+        mappedBytes = (reservedLimit + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+        void* mapping = mmap(nullptr, mappedBytes + HUGE_PAGE_BYTES, protection, flags, -1, 0);
+
+        if (mapping != MAP_FAILED) {
+            uint8_t* base = static_cast<uint8_t*>(mapping);
+            size_t head = (HUGE_PAGE_BYTES - reinterpret_cast<uintptr_t>(base) % HUGE_PAGE_BYTES) % HUGE_PAGE_BYTES;
+
+            if (head > 0) {
+                munmap(base, head);
+            }
+            munmap(base + head + mappedBytes, HUGE_PAGE_BYTES - head);
+
+            memoryStart = base + head;
+
+            // Without transparent huge pages the aligned mapping still works with base pages
+            if (madvise(memoryStart, mappedBytes, MADV_HUGEPAGE) == 0) {
+                pages = Pages::Transparent;
+                pageBytes = HUGE_PAGE_BYTES;
+            }
+        }
+    }
+
+    if (memoryStart == MAP_FAILED) {
+        mappedBytes = (reservedLimit + basePageBytes() - 1) / basePageBytes() * basePageBytes();
+        memoryStart = mmap(nullptr, mappedBytes, protection, flags, -1, 0);
+    }
+
+    if (memoryStart == MAP_FAILED) {
+        memoryStart = nullptr;
+        return false;
+    }
+
+    if (growable && memoryLimit > 0 && mprotect(memoryStart, roundToPage(memoryLimit), PROT_READ | PROT_WRITE) != 0) {
+        munmap(memoryStart, mappedBytes);
+        memoryStart = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+size_t MemoryManager::roundToPage(size_t bytes) const {
+    // Growth commits whole pages of the backing, huge pages are not split
+    return std::min((bytes + pageBytes - 1) / pageBytes * pageBytes, mappedBytes);
+}
+
+void MemoryManager::setLayout(Layout layout) {
+    this->layout = layout;
+
+    if (layout == Layout::BoundaryTags) {
+        tagWords = (sizeof(BoundaryTag) + wordSize - 1) / wordSize;
+        minBlockWords = 2 * tagWords + (sizeof(HoleIterator) + wordSize - 1) / wordSize;
+    } else {
+        tagWords = 0;
+        minBlockWords = 1;
+    }
 }
 
 void MemoryManager::shutdown() {
+    stopScavenger();
+
+    for (const auto& large : largeBlocks) {
+        munmap(reinterpret_cast<void*>(large.first), large.second);
+    }
+    largeBlocks.clear();
+    largeBlockBytes = 0;
+
+    segments.clear();
+    segmentByAddress.clear();
+    currentSegment = nullptr;
+    segmentWords = 0;
+
     // Check if memory allocated
     if (memoryStart != nullptr) {
-        munmap(memoryStart, memoryLimit);
+        munmap(memoryStart, mappedBytes);
 
         memoryLimit = 0;
+        reservedLimit = 0;
         memoryStart = nullptr;
     }
 
     holeList.clear();
+    rover = holeList.end();
+    clearTracking();
     allocatedList.clear();
+    holeNodes.release();
+    blockNodes.release();
+    sizeNodes.release();
+
+    blockIndex.release();
+    holeByStart.release();
+    holeByEnd.release();
+    holeStarts.clear();
+    allocationBitmap.clear();
+    decommittedPages.clear();
+    decommittedBytes = 0;
 }
 
 void* MemoryManager::allocate(size_t sizeInBytes) {
+    auto lock = lockAllocator();
+    return allocateBytes(sizeInBytes, 0);
+}
+
+void* MemoryManager::allocateAligned(size_t sizeInBytes, size_t alignment) {
+    // Validate 'alignment'
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        throw std::invalid_argument("Expected alignment to be a power of two, but got " + std::to_string(alignment));
+    }
+
+    auto lock = lockAllocator();
+    return allocateBytes(sizeInBytes, alignment);
+}
+
+void* MemoryManager::allocateBytes(size_t sizeInBytes, size_t alignment) {
+    // Large requests get a mapping of their own, which is only page aligned
+    if (largeBlockThreshold != 0 && sizeInBytes >= largeBlockThreshold && alignment <= basePageBytes() &&
+        (memoryStart != nullptr || segmentWords != 0)) {
+        return allocateLarge(sizeInBytes);
+    }
+
+    if (segmentWords != 0) {
+        return allocateSegmented(sizeInBytes, alignment);
+    }
+
     if (memoryStart == nullptr || sizeInBytes == 0) {
         return nullptr;
     }
 
-    unsigned int sizeInWords = (sizeInBytes + wordSize - 1) / wordSize; // Round up to nearest word
+    // Larger than the whole reservation, also keeps the word count below 32 bits
+    if (sizeInBytes > reservedLimit) {
+        return nullptr;
+    }
+
+    size_t requestedWords = wordsCeil(sizeInBytes); // Round up to nearest word
+
+    // Boundary tags travel with the block
+    if (layout == Layout::BoundaryTags) {
+        requestedWords = std::max<size_t>(requestedWords + 2 * tagWords, minBlockWords);
+        if (requestedWords > wordsFloor(reservedLimit)) {
+            return nullptr;
+        }
+    }
+
+    unsigned int sizeInWords = static_cast<unsigned int>(requestedWords);
+
+    // No block can start before the first aligned payload of the reservation
+    if (alignment > 1) {
+        size_t firstAligned = wordsToAlignment(0, alignment);
+        if (firstAligned == SIZE_MAX || firstAligned + sizeInWords > wordsFloor(reservedLimit)) {
+            return nullptr;
+        }
+    }
+
+    // Growable pools commit more of their reservation, enough for the worst-case slack, and retry once
+    void* allocatedMemory = allocateWords(sizeInWords, alignment);
+    if (allocatedMemory == nullptr && grow(sizeInWords + maxAlignmentSlack(alignment))) {
+        allocatedMemory = allocateWords(sizeInWords, alignment);
+    }
 
-    // Check if enough memory available
-    void* list = getList();
-    if (list == nullptr) {
+    return allocatedMemory;
+}
+
+void* MemoryManager::allocateSegmented(size_t sizeInBytes, size_t alignment) {
+    if (sizeInBytes == 0) {
         return nullptr;
     }
 
-    // Find hole according to allocation strategy
-    int wordOffset = allocator(sizeInWords, list);
+    // No segment can hold the request with its tags and slack; checked in bytes so the word count cannot overflow
+    size_t overheadWords = 2 * tagWords + maxAlignmentSlack(alignment);
+    if (overheadWords >= maxPoolWords() || sizeInBytes > (maxPoolWords() - overheadWords) * wordSize) {
+        return nullptr;
+    }
+
+    // The segment that served the last request usually still fits, then chain order
+    if (void* allocatedMemory = currentSegment->allocateBytes(sizeInBytes, alignment)) {
+        return allocatedMemory;
+    }
 
-    delete[] static_cast<uint16_t*>(list);
+    for (auto& segment : segments) {
+        if (segment.get() != currentSegment) {
+            if (void* allocatedMemory = segment->allocateBytes(sizeInBytes, alignment)) {
+                currentSegment = segment.get();
+                return allocatedMemory;
+            }
+        }
+    }
 
-    // Check if suitable hole found
-    if (wordOffset == -1) {
+    // Chain a new segment, enlarged for requests that would not fit an empty default one
+    size_t requestedWords = wordsCeil(sizeInBytes) + 2 * tagWords + maxAlignmentSlack(alignment);
+    size_t sizeInWords = std::max(segmentWords, (std::max<size_t>(requestedWords, minBlockWords) + 7) / 8 * 8);
+    if (sizeInWords > maxPoolWords()) {
         return nullptr;
     }
 
-    // Find and update hole in hole list
-    for (auto it = holeList.begin(); it != holeList.end(); ++it) {
-        if (it->offset == wordOffset) {
+    try {
+        currentSegment = addSegment(sizeInWords);
+    } catch (const std::runtime_error&) {
+        return nullptr;
+    }
 
-            // Allocate memory from hole
-            void* allocatedMemory = static_cast<uint8_t*>(memoryStart) + (wordOffset * wordSize);
+    // Only 'free' releases segments, so one the request still fails in would be kept forever
+    void* allocatedMemory = currentSegment->allocateBytes(sizeInBytes, alignment);
+    if (allocatedMemory == nullptr) {
+        releaseSegment(currentSegment);
+    }
 
-            // Add to 'allocatedList'
-            Block block = { static_cast<unsigned int>(wordOffset), sizeInWords };
+    return allocatedMemory;
+}
 
-            auto itr = allocatedList.begin();
-            while (itr != allocatedList.end() && itr->offset < block.offset) {
-                ++itr;
-            }
+MemoryManager* MemoryManager::addSegment(size_t sizeInWords) {
+    // Same engine and strategy as this manager
+    std::unique_ptr<MemoryManager> segment(engine == Engine::Strategy
+        ? new MemoryManager(wordSize, allocator)
+        : new MemoryManager(wordSize, engine));
+    segment->setPages(preferredPages);
+    segment->setPrefaultTables(prefaultTables);
+    segment->setReleasePolicy(releasePolicy);
+    segment->setSizeIndex(sizeIndex);
+    segment->deferRelease = deferRelease;
+    segment->initialize(sizeInWords, layout);
+
+    MemoryManager* added = segment.get();
+    segmentByAddress[reinterpret_cast<uintptr_t>(added->memoryStart)] = added;
+    segments.push_back(std::move(segment));
+
+    return added;
+}
 
-            allocatedList.insert(itr, block);
+MemoryManager* MemoryManager::segmentOf(void* address) {
+    // Last segment starting at or before 'address'
+    auto it = segmentByAddress.upper_bound(reinterpret_cast<uintptr_t>(address));
+    if (it == segmentByAddress.begin()) {
+        return nullptr;
+    }
+    --it;
 
-            // Update 'holeList'
+    MemoryManager* segment = it->second;
+    return reinterpret_cast<uintptr_t>(address) - it->first < segment->memoryLimit ? segment : nullptr;
+}
 
-            // If "exact fit"
-            if (it->length == sizeInWords) {
-                holeList.erase(it);
-            
-            // Otherwise "partial fit"
-            } else {
-                it->offset += sizeInWords;
-                it->length -= sizeInWords;
-            }
+void MemoryManager::releaseSegment(MemoryManager* segment) {
+    segmentByAddress.erase(reinterpret_cast<uintptr_t>(segment->memoryStart));
 
-            return allocatedMemory;
-        }
+    auto it = std::find_if(segments.begin(), segments.end(), [segment](const std::unique_ptr<MemoryManager>& s) {
+        return s.get() == segment;
+    });
+    segments.erase(it);
+
+    if (currentSegment == segment) {
+        currentSegment = segments.front().get();
     }
+}
 
-    return nullptr;
+bool MemoryManager::isEmpty() const {
+    return holeList.size() == 1 && holeList.front().length == wordsFloor(memoryLimit);
 }
 
-void MemoryManager::free(void* address) {
-    if (memoryStart == nullptr || address == nullptr) {
-        return;
+size_t MemoryManager::maxPoolWords() const {
+    // Legacy strategies see 16-bit offsets and lengths
+    return legacyAllocator ? MAX_NUM_WORDS : MAX_WIDE_NUM_WORDS;
+}
+
+size_t MemoryManager::poolWords() const {
+    if (segmentWords == 0) {
+        return wordsFloor(memoryLimit);
     }
 
-    size_t offsetInBytes = static_cast<uint8_t*>(address) - static_cast<uint8_t*>(memoryStart);
-    
-    unsigned int wordOffset = offsetInBytes / wordSize;
-
-    // Find length of allocated block
-    unsigned int allocatedLength = 0;
-    for (auto it = allocatedList.begin(); it != allocatedList.end(); ++it) {
-        if (it->offset == wordOffset) {
-            allocatedLength = it->length;
-            allocatedList.erase(it);
-            
-            // Add to 'holeList'
-            Hole hole = { static_cast<unsigned int>(wordOffset), allocatedLength };
-
-            auto itr = holeList.begin();
-            while (itr != holeList.end() && itr->offset < hole.offset) {
-                ++itr;
+    size_t words = 0;
+    for (const auto& segment : segments) {
+        words += wordsFloor(segment->memoryLimit);
+    }
+    return words;
+}
+
+void* MemoryManager::allocateWords(unsigned int sizeInWords, size_t alignment) {
+    // Engines look for room for the worst-case slack, which any hole they return can align within
+    size_t searchWords = sizeInWords + maxAlignmentSlack(alignment);
+
+    if (engine != Engine::Strategy) {
+        HoleIterator hole = holeList.end();
+
+        // TLSF engine maps the request straight to a hole
+        if (engine == Engine::TLSF) {
+            if (searchWords > UINT32_MAX || !tlsf.find(static_cast<unsigned int>(searchWords), hole)) {
+                hole = holeList.end();
+            }
+
+        // Bitmap engine takes the lowest free run long enough, which always starts a hole
+        } else if (engine == Engine::Bitmap) {
+            size_t start = allocationBitmap.findFreeRun(searchWords);
+            if (start != AllocationBitmap::NOT_FOUND) {
+                hole = holeAt(static_cast<unsigned int>(start));
             }
 
-            holeList.insert(itr, hole);
+        // Worst-fit engine only ever looks at the top of its heap
+        } else if (!holeHeap.empty() && holeHeap.top()->length >= searchWords) {
+            hole = holeHeap.top();
+        }
+
+        // A hole shorter than the worst case may still align with less slack, worth a scan only if one is long enough
+        if (hole == holeList.end() && alignment != 0) {
+            HoleIterator candidate;
+            bool longEnough = engine == Engine::TLSF ? tlsf.find(sizeInWords, candidate)
+                            : engine == Engine::Bitmap ? allocationBitmap.findFreeRun(sizeInWords) != AllocationBitmap::NOT_FOUND
+                            : !holeHeap.empty() && holeHeap.top()->length >= sizeInWords;
 
-            break;
+            if (longEnough) {
+                hole = firstAlignedFit(sizeInWords, alignment);
+            }
         }
+
+        return hole == holeList.end() ? nullptr : allocateAligned(hole, sizeInWords, alignment);
     }
 
-    // Check if block found
-    if (allocatedLength == 0) {
-        return;
+    // Check if enough memory available; strategies take the size as an 'int'
+    if (holeList.empty() || sizeInWords > static_cast<unsigned int>(INT_MAX)) {
+        return nullptr;
     }
 
-    mergeHoles();
+    // Find hole according to allocation strategy
+    HoleView holes(*this, alignment);
+    auto hole = allocator(sizeInWords, holes);
+
+    // Check if suitable hole found, strategies unaware of alignment may pick one that is not
+    if (hole == holeList.end() || (alignment != 0 && holes.usableLength(hole) < sizeInWords)) {
+        return nullptr;
+    }
+
+    // Empty erase turns the strategy's read-only handle back into a mutable one
+    return allocateAligned(holeList.erase(hole, hole), sizeInWords, alignment);
 }
 
-void MemoryManager::mergeHoles() {
-    auto it = holeList.begin();
-    while (it != holeList.end()) {
-        auto next = std::next(it);
-        if (next != holeList.end() && it->offset + it->length == next->offset) {
-            it->length += next->length;
-            holeList.erase(next);
-        } else {
-            ++it;
+// Lowest-offset hole an aligned block fits in, after its slack
+MemoryManager::HoleIterator MemoryManager::firstAlignedFit(unsigned int sizeInWords, size_t alignment) {
+    HoleIterator best = holeList.end();
+    for (auto hole = holeList.begin(); hole != holeList.end(); ++hole) {
+        size_t slack = alignmentSlack(hole->offset, alignment);
+        if (slack < hole->length && hole->length - slack >= sizeInWords && (best == holeList.end() || hole->offset < best->offset)) {
+            best = hole;
         }
     }
-}
 
-void MemoryManager::setAllocator(std::function<int(int, void*)> allocator) {
-    this->allocator = allocator;
+    return best;
 }
 
-// Getters
+void* MemoryManager::allocateAligned(HoleIterator hole, unsigned int sizeInWords, size_t alignment) {
+    size_t slack = alignmentSlack(hole->offset, alignment);
+    if (slack == 0) {
+        return allocateFromHole(hole, sizeInWords);
+    }
 
-void* MemoryManager::getList() {
-    if (holeList.empty()) {
+    if (slack == SIZE_MAX) {
         return nullptr;
     }
 
-    uint16_t* list = new uint16_t[1 + holeList.size() * 2]; // 1 for count, 2 per hole
-    list[0] = static_cast<uint16_t>(holeList.size());       // Hole count
+    // The slack stays behind as a hole of its own, the block is carved from the rest
+    unsigned int offset = hole->offset;
+    unsigned int length = hole->length;
+    resizeHole(hole, offset, static_cast<unsigned int>(slack));
+    auto rest = insertHole(std::next(hole), offset + static_cast<unsigned int>(slack), length - static_cast<unsigned int>(slack));
 
-    size_t index = 1;
-    for (const auto& hole : holeList) {
-        list[index++] = static_cast<uint16_t>(hole.offset);
-        list[index++] = static_cast<uint16_t>(hole.length);
+    // The slack's new footer may lie on a released page
+    if (layout == Layout::BoundaryTags) {
+        recommit(offset + slack - tagWords, tagWords);
     }
 
-    return list;
+    return allocateFromHole(rest, sizeInWords);
 }
 
-void* MemoryManager::getBitmap() {
-    if (memoryStart == nullptr) {
-        return nullptr;
+// Leading words to skip from 'offset' so the payload lands on an 'alignment' boundary, SIZE_MAX if it never does
+size_t MemoryManager::alignmentSlack(size_t offset, size_t alignment) const {
+    size_t slack = wordsToAlignment(offset, alignment);
+
+    // Slack in the boundary-tag layout becomes a hole, which needs room for its tags
+    if (layout == Layout::BoundaryTags && slack != 0 && slack != SIZE_MAX && slack < minBlockWords) {
+        size_t stride = alignmentStride(alignment);
+        slack += (minBlockWords - slack + stride - 1) / stride * stride;
     }
 
-    unsigned int numWords = memoryLimit / wordSize;
+    return slack;
+}
 
-    unsigned int bitmapSizeInBytes = (numWords + 7) / 8;  // Round up to nearest byte
+// Smallest 'slack' with the payload at 'offset + slack' aligned, SIZE_MAX if none; 'alignment' is a power of two
+size_t MemoryManager::wordsToAlignment(size_t offset, size_t alignment) const {
+    if (alignment <= 1) {
+        return 0;
+    }
 
-    uint8_t* bitmap = new uint8_t[2 + bitmapSizeInBytes];
+    uintptr_t payload = reinterpret_cast<uintptr_t>(memoryStart) + (offset + tagWords) * wordSize;
+    size_t misalignment = (alignment - payload % alignment) % alignment;
+    if (isWordAligned(misalignment)) {
+        return wordsFloor(misalignment);
+    }
 
-    bitmap[0] = static_cast<uint8_t>(bitmapSizeInBytes & 0xFF);         // Lower byte
-    bitmap[1] = static_cast<uint8_t>((bitmapSizeInBytes >> 8) & 0xFF);  // Higher byte
-    
-    std::memset(bitmap + 2, 0, bitmapSizeInBytes);  // Unset all bits
-    
-    // Set bits according to allocated blocks
-    for (const auto& block : allocatedList) {
-        for (unsigned int l = 0; l < block.length; ++l) {
-            unsigned int wordIndex = block.offset + l;
-            unsigned int byteIndex = wordIndex / 8;
-            unsigned int bitIndex = wordIndex % 8;
+    // Odd word sizes wrap around the boundary: solve slack * wordSize = misalignment (mod alignment).
+    // With g = gcd(wordSize, alignment) that needs g | misalignment, and then
+    // slack = (misalignment / g) * (wordSize / g)^-1 mod stride
+    size_t g = std::gcd(alignment, static_cast<size_t>(wordSize));
+    if (misalignment % g != 0) {
+        return SIZE_MAX;
+    }
 
-            bitmap[2 + byteIndex] |= (1 << bitIndex);
-        }
+    // 'stride' is a power of two and 'wordSize / g' odd; Newton's iteration doubles the correct low bits of the inverse
+    size_t stride = alignment / g;
+    size_t odd = wordSize / g;
+    size_t inverse = odd;
+    for (int bits = 3; bits < 64; bits *= 2) {
+        inverse *= 2 - odd * inverse;
     }
 
-    return bitmap;
+    return (misalignment / g) * inverse & (stride - 1);
 }
 
-unsigned int MemoryManager::getWordSize() {
-    return wordSize;
+// Words between consecutive aligned payloads
+size_t MemoryManager::alignmentStride(size_t alignment) const {
+    return alignment / std::gcd(alignment, static_cast<size_t>(wordSize));
 }
 
-void* MemoryManager::getMemoryStart() {
-    return memoryStart;
-}
+size_t MemoryManager::maxAlignmentSlack(size_t alignment) const {
+    if (alignment <= 1) {
+        return 0;
+    }
 
-unsigned int MemoryManager::getMemoryLimit() {
-    return memoryLimit;
+    return alignmentStride(alignment) - 1 + (layout == Layout::BoundaryTags ? minBlockWords : 0);
 }
 
-// Debugging
-
-int MemoryManager::dumpMemoryMap(char* filename) {
-    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0777);
+bool MemoryManager::grow(size_t minimumWords) {
+    size_t oldWords = wordsFloor(memoryLimit);
+    size_t reservedWords = wordsFloor(reservedLimit);
 
-    if (fd == -1) {
-        return -1;  // Error opening file
+    if (minimumWords > reservedWords - oldWords) {
+        return false;
     }
 
-    for (auto it = holeList.begin(); it != holeList.end(); ++it) {
-        std::string msg = "[" + std::to_string(it->offset) + ", " + std::to_string(it->length) + "]";
+    // At least double so repeated growth stays amortized O(1) per word
+    size_t newWords = std::min(reservedWords, std::max(oldWords + minimumWords, 2 * oldWords));
+    size_t newLimit = newWords * wordSize;
 
-        int nb = write(fd, msg.data(), msg.size());
+    // The page holding the old end is already committed; the mapping itself is whole pages
+    size_t commitStart = roundToPage(memoryLimit);
+    size_t commitEnd = roundToPage(newLimit);
 
-        if (nb == -1) {
-            if (close(fd) == -1) {
-                return -1;  // Error closing file
-            }
+    if (commitEnd > commitStart &&
+        mprotect(static_cast<uint8_t*>(memoryStart) + commitStart, commitEnd - commitStart, PROT_READ | PROT_WRITE) != 0) {
+        return false;
+    }
+
+    memoryLimit = newLimit;
 
-            return -1;  // Error writing to file
+    allocationBitmap.resize(newWords);
+    if (layout == Layout::OutOfBand) {
+        if (prefaultTables) {
+            commitTables(newWords);
         }
+        holeStarts.resize(newWords);
+    }
 
-        auto next = std::next(it);
-        if (next != holeList.end()) {
-            std::string delim = " - ";
+    // The new tail joins the hole ending at the old limit, or becomes the last hole (or the first, in a pool that started empty)
+    auto left = holeList.end();
+    if (layout == Layout::BoundaryTags && oldWords > 0) {
+        BoundaryTag footer = readTag(oldWords - tagWords);
+        if (footer.allocated != TAG_ALLOCATED) {
+            left = readHoleHandle(oldWords - footer.length);
+        }
+    } else if (layout == Layout::OutOfBand) {
+        left = holeByEnd[oldWords];
+    }
 
-            write(fd, delim.data(), delim.size());
+    coalesce(oldWords, newWords - oldWords, left, holeList.end(), holeList.end());
+
+    return true;
+}
+
+void* MemoryManager::allocateFromHole(HoleIterator hole, unsigned int sizeInWords) {
+    unsigned int wordOffset = hole->offset;
+    rover = hole;
+
+    if (layout == Layout::BoundaryTags) {
+        // Absorb a remainder too small to carry its own tags
+        if (hole->length - sizeInWords < minBlockWords) {
+            sizeInWords = hole->length;
         }
+
+        writeTags(wordOffset, sizeInWords, TAG_ALLOCATED);
+    } else {
+        // Add to 'allocatedList' (unordered, only ever searched by offset)
+        allocatedList.push_back(Block{ wordOffset, sizeInWords });
+        blockIndex.set(wordOffset, std::prev(allocatedList.end()));
     }
 
-    if (close(fd) == -1) {
-        return -1;  // Error closing file
+    allocationBitmap.setRange(wordOffset, sizeInWords);
+
+    // The block and the tags of a remaining hole are written from here on
+    size_t touchedWords = sizeInWords;
+    if (layout == Layout::BoundaryTags && hole->length > sizeInWords) {
+        touchedWords += minBlockWords - tagWords;
     }
+    recommit(wordOffset, touchedWords);
 
-    return 0;
+    // Allocate memory from hole
+    void* allocatedMemory = wordAddress(wordOffset + tagWords);
+
+    // Update 'holeList'
+
+    // If "exact fit"
+    if (hole->length == sizeInWords) {
+        eraseHole(hole);
+
+    // Otherwise "partial fit"
+    } else {
+        resizeHole(hole, hole->offset + sizeInWords, hole->length - sizeInWords);
+    }
+
+    return allocatedMemory;
 }
 
-// Allocators
+void MemoryManager::free(void* address) {
+    auto lock = lockAllocator();
+    freeBlock(address);
+}
 
-int bestFit(int sizeInWords, void* list) {
-    uint16_t* holeList = static_cast<uint16_t*>(list);
-    uint16_t holeCount = holeList[0];
+void* MemoryManager::reallocate(void* address, size_t newSizeInBytes) {
+    auto lock = lockAllocator();
 
-    int bestOffset = -1;
-    int bestLength = MemoryManager::MAX_NUM_WORDS + 1;
+    if (address == nullptr) {
+        return allocateBytes(newSizeInBytes, 0);
+    }
 
-    for (uint16_t i = 0; i < holeCount; i++) {
-        uint16_t offset = holeList[1 + i * 2];
-        uint16_t length = holeList[2 + i * 2];
+    if (newSizeInBytes == 0) {
+        freeBlock(address);
+        return nullptr;
+    }
 
-        // Check if smaller suitable hole found
-        if (length >= sizeInWords && length < bestLength) {
-            bestOffset = offset;
-            bestLength = length;
+    if (!largeBlocks.empty()) {
+        auto large = largeBlocks.find(reinterpret_cast<uintptr_t>(address));
+        if (large != largeBlocks.end()) {
+            return reallocateLarge(large, newSizeInBytes);
         }
     }
 
-    return bestOffset;
+    MemoryManager* owner = segmentWords != 0 ? segmentOf(address) : this;
+    if (owner == nullptr) {
+        return nullptr;
+    }
+
+    // Blocks growing past the threshold move out of the pool; a size no pool holds only looks the block up
+    bool movesOut = largeBlockThreshold != 0 && newSizeInBytes >= largeBlockThreshold;
+
+    size_t oldSizeInBytes = 0;
+    switch (owner->resizeBlock(address, movesOut ? SIZE_MAX : newSizeInBytes, oldSizeInBytes)) {
+        case Resize::Grown:
+            reallocateStats.grownInPlace++;
+            return address;
+        case Resize::Shrunk:
+            reallocateStats.shrunkInPlace++;
+            return address;
+        case Resize::Unchanged:
+            return address;
+        case Resize::NotABlock:
+            return nullptr;
+        case Resize::NoRoom:
+            break;
+    }
+
+    // Neither neighbour has room, the block moves; on failure the original stays valid
+    void* moved = allocateBytes(newSizeInBytes, 0);
+    if (moved == nullptr) {
+        return nullptr;
+    }
+
+    std::memcpy(moved, address, std::min(oldSizeInBytes, newSizeInBytes));
+    freeBlock(address);
+    reallocateStats.moved++;
+
+    return moved;
 }
 
-int worstFit(int sizeInWords, void* list) {
-    uint16_t* holeList = static_cast<uint16_t*>(list);
-    uint16_t holeCount = holeList[0];
+void* MemoryManager::allocateLarge(size_t sizeInBytes) {
+    size_t mapped = (sizeInBytes + basePageBytes() - 1) / basePageBytes() * basePageBytes();
+    if (mapped < sizeInBytes) {
+        return nullptr;
+    }
 
-    int bestOffset = -1;
-    int bestLength = -1;
+    void* block = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (block == MAP_FAILED) {
+        return nullptr;
+    }
 
-    for (uint16_t i = 0; i < holeCount; i++) {
-        uint16_t offset = holeList[1 + i * 2];
-        uint16_t length = holeList[2 + i * 2];
+    largeBlocks[reinterpret_cast<uintptr_t>(block)] = mapped;
+    largeBlockBytes += mapped;
 
-        // Check if larger suitable hole found
-        if (length >= sizeInWords && length > bestLength) {
-            bestOffset = offset;
-            bestLength = length;
+    return block;
+}
+
+void* MemoryManager::reallocateLarge(std::map<uintptr_t, size_t>::iterator large, size_t newSizeInBytes) {
+    void* address = reinterpret_cast<void*>(large->first);
+    size_t mapped = large->second;
+
+    // Shrunk below the threshold, back into the pool
+    if (newSizeInBytes < largeBlockThreshold) {
+        void* moved = allocateBytes(newSizeInBytes, 0);
+        if (moved == nullptr) {
+            return nullptr;
         }
+
+        std::memcpy(moved, address, newSizeInBytes);
+        freeLarge(address);
+        reallocateStats.moved++;
+
+        return moved;
     }
 
-    return bestOffset;
+    // The kernel moves the page table entries, nothing is copied
+    size_t newMapped = (newSizeInBytes + basePageBytes() - 1) / basePageBytes() * basePageBytes();
+    if (newMapped < newSizeInBytes) {
+        return nullptr;
+    }
+
+    void* remapped = newMapped == mapped ? address : mremap(address, mapped, newMapped, MREMAP_MAYMOVE);
+    if (remapped == MAP_FAILED) {
+        return nullptr;
+    }
+
+    largeBlocks.erase(large);
+    largeBlocks[reinterpret_cast<uintptr_t>(remapped)] = newMapped;
+    largeBlockBytes = largeBlockBytes - mapped + newMapped;
+    reallocateStats.remapped++;
+
+    return remapped;
+}
+
+bool MemoryManager::freeLarge(void* address) {
+    if (largeBlocks.empty()) {
+        return false;
+    }
+
+    auto large = largeBlocks.find(reinterpret_cast<uintptr_t>(address));
+    if (large == largeBlocks.end()) {
+        return false;
+    }
+
+    munmap(address, large->second);
+    largeBlockBytes -= large->second;
+    largeBlocks.erase(large);
+
+    return true;
+}
+
+void MemoryManager::freeBlock(void* address) {
+    if (segmentWords != 0) {
+        MemoryManager* segment = segmentOf(address);
+        if (segment == nullptr) {
+            freeLarge(address);
+            return;
+        }
+
+        segment->freeBlock(address);
+
+        // Hand empty segments back to the OS, keeping one to serve the next request
+        if (segments.size() > 1 && segment->isEmpty()) {
+            releaseSegment(segment);
+        }
+
+        return;
+    }
+
+    if (memoryStart == nullptr || address == nullptr) {
+        return;
+    }
+
+    size_t offsetInBytes = static_cast<uint8_t*>(address) - static_cast<uint8_t*>(memoryStart);
+
+    // Check if address inside pool, otherwise it may be a large block
+    if (offsetInBytes >= memoryLimit) {
+        freeLarge(address);
+        return;
+    }
+
+    unsigned int wordOffset = wordsFloor(offsetInBytes);
+
+    if (layout == Layout::BoundaryTags) {
+        freeTagged(wordOffset);
+        return;
+    }
+
+    // Find allocated block
+    auto block = blockIndex[wordOffset];
+    if (block == allocatedList.end()) {
+        return;
+    }
+
+    unsigned int allocatedLength = block->length;
+    unsigned int wordEnd = wordOffset + allocatedLength;
+
+    allocatedList.erase(block);
+    blockIndex.set(wordOffset, allocatedList.end());
+
+    // Neighbouring holes end right before and start right after the block
+    auto left = holeByEnd[wordOffset];
+    auto right = holeByStart[wordEnd];
+
+    // Isolated block lands before the next hole in address order
+    auto position = holeList.end();
+    if (left == holeList.end() && right == holeList.end()) {
+        position = holeByStart[holeStarts.findNext(wordEnd)];
+    }
+
+    releaseHole(coalesce(wordOffset, allocatedLength, left, right, position));
+}
+
+MemoryManager::Resize MemoryManager::resizeBlock(void* address, size_t newSizeInBytes, size_t& oldSizeInBytes) {
+    if (memoryStart == nullptr) {
+        return Resize::NotABlock;
+    }
+
+    size_t offsetInBytes = static_cast<uint8_t*>(address) - static_cast<uint8_t*>(memoryStart);
+    if (offsetInBytes >= memoryLimit || !isWordAligned(offsetInBytes)) {
+        return Resize::NotABlock;
+    }
+
+    unsigned int wordOffset = wordsFloor(offsetInBytes);
+
+    // Locate the block, its length in words and the hole right after it
+    unsigned int blockOffset;
+    unsigned int length;
+    BlockIterator block = allocatedList.end();
+
+    if (layout == Layout::BoundaryTags) {
+        if (wordOffset < tagWords) {
+            return Resize::NotABlock;
+        }
+
+        blockOffset = wordOffset - tagWords;
+        BoundaryTag header = readTag(blockOffset);
+        if (header.allocated != TAG_ALLOCATED) {
+            return Resize::NotABlock;
+        }
+        length = header.length;
+    } else {
+        block = blockIndex[wordOffset];
+        if (block == allocatedList.end()) {
+            return Resize::NotABlock;
+        }
+        blockOffset = wordOffset;
+        length = block->length;
+    }
+
+    oldSizeInBytes = size_t(length - 2 * tagWords) * wordSize;
+
+    if (newSizeInBytes > reservedLimit) {
+        return Resize::NoRoom;
+    }
+
+    size_t newLength = wordsCeil(newSizeInBytes);
+    if (layout == Layout::BoundaryTags) {
+        newLength = std::max<size_t>(newLength + 2 * tagWords, minBlockWords);
+    }
+
+    unsigned int blockEnd = blockOffset + length;
+    auto right = holeList.end();
+    if (layout == Layout::BoundaryTags) {
+        if (blockEnd < wordsFloor(memoryLimit) && readTag(blockEnd).allocated != TAG_ALLOCATED) {
+            right = readHoleHandle(blockEnd);
+        }
+    } else {
+        right = holeByStart[blockEnd];
+    }
+
+    // Grow into the hole that follows
+    if (newLength > length) {
+        size_t extra = newLength - length;
+        if (right == holeList.end() || right->length < extra) {
+            return Resize::NoRoom;
+        }
+
+        // Absorb a remainder too small to carry its own tags
+        if (layout == Layout::BoundaryTags && right->length - extra < minBlockWords) {
+            extra = right->length;
+        }
+
+        size_t touchedWords = extra;
+        if (right->length == extra) {
+            eraseHole(right);
+        } else {
+            resizeHole(right, blockEnd + static_cast<unsigned int>(extra), right->length - static_cast<unsigned int>(extra));
+            touchedWords += layout == Layout::BoundaryTags ? minBlockWords - tagWords : 0;
+        }
+
+        length += static_cast<unsigned int>(extra);
+        if (layout == Layout::BoundaryTags) {
+            writeTags(blockOffset, length, TAG_ALLOCATED);
+        } else {
+            block->length = length;
+        }
+
+        allocationBitmap.setRange(blockEnd, extra);
+        recommit(blockEnd, touchedWords);
+
+        return Resize::Grown;
+    }
+
+    // Shrink by handing the tail to the hole list; a tail too small for tags only goes to a following hole
+    unsigned int tail = length - static_cast<unsigned int>(newLength);
+    if (tail == 0) {
+        return Resize::Unchanged;
+    }
+    if (layout == Layout::BoundaryTags && tail < minBlockWords && right == holeList.end()) {
+        return Resize::Shrunk;
+    }
+
+    length -= tail;
+    auto position = holeList.end();
+    if (layout == Layout::BoundaryTags) {
+        writeTags(blockOffset, length, TAG_ALLOCATED);
+    } else {
+        block->length = length;
+
+        // Tail lands before the next hole in address order
+        if (right == holeList.end()) {
+            position = holeByStart[holeStarts.findNext(blockEnd)];
+        }
+    }
+
+    releaseHole(coalesce(blockOffset + length, tail, holeList.end(), right, position));
+
+    return Resize::Shrunk;
+}
+
+MemoryManager::HoleIterator MemoryManager::coalesce(unsigned int offset, unsigned int length, HoleIterator left, HoleIterator right, HoleIterator position) {
+    allocationBitmap.clearRange(offset, length);
+
+    // Merge with the immediate neighbours only
+    if (left != holeList.end() && right != holeList.end()) {
+        unsigned int merged = left->length + length + right->length;
+
+        // A rover on the absorbed hole stays on the space it pointed to
+        if (rover == right) {
+            rover = left;
+        }
+
+        eraseHole(right);
+        resizeHole(left, left->offset, merged);
+        return left;
+    } else if (left != holeList.end()) {
+        resizeHole(left, left->offset, left->length + length);
+        return left;
+    } else if (right != holeList.end()) {
+        resizeHole(right, offset, length + right->length);
+        return right;
+    } else {
+        return insertHole(position, offset, length);
+    }
+}
+
+void MemoryManager::releaseHole(HoleIterator hole) {
+    if (deferRelease || releasePolicy.advice == ReleasePolicy::Advice::None || size_t(hole->length) * wordSize < releasePolicy.minHoleBytes) {
+        return;
+    }
+
+    decommitHole(hole);
+}
+
+// Returns the bytes released
+size_t MemoryManager::decommitHole(HoleIterator hole) {
+    // The policy may have been switched to None while the scavenger runs
+    if (releasePolicy.advice == ReleasePolicy::Advice::None) {
+        return 0;
+    }
+
+    // Whole pages inside the hole, clear of its own tags and handle
+    size_t metadataWords = layout == Layout::BoundaryTags ? minBlockWords - tagWords : 0;
+    size_t startByte = (size_t(hole->offset) + metadataWords) * wordSize;
+    size_t endByte = (size_t(hole->offset) + hole->length - tagWords) * wordSize;
+    size_t firstPage = (startByte + pageBytes - 1) / pageBytes;
+    size_t lastPage = endByte / pageBytes;
+
+    if (lastPage <= firstPage) {
+        return 0;
+    }
+
+    // Hysteresis: a hot hole only regains a few resident pages between frees, not enough to release again
+    size_t pageCount = lastPage - firstPage;
+    size_t residentPages = pageCount - decommittedPages.count(firstPage, pageCount);
+    if (residentPages == 0 || residentPages * pageBytes < releasePolicy.minReleaseBytes) {
+        return 0;
+    }
+
+    void* start = static_cast<uint8_t*>(memoryStart) + firstPage * pageBytes;
+    size_t length = pageCount * pageBytes;
+    bool released = false;
+
+#ifdef MADV_FREE
+    // Older kernels and hugetlb mappings reject MADV_FREE
+    if (releasePolicy.advice == ReleasePolicy::Advice::Free) {
+        released = madvise(start, length, MADV_FREE) == 0;
+    }
+#endif
+
+    if (!released && madvise(start, length, MADV_DONTNEED) != 0) {
+        return 0;
+    }
+
+    decommittedPages.setRange(firstPage, pageCount);
+    decommittedBytes += residentPages * pageBytes;
+
+    return residentPages * pageBytes;
+}
+
+void MemoryManager::recommit(size_t offset, size_t length) {
+    if (decommittedBytes == 0) {
+        return;
+    }
+
+    // Every page the words touch is resident again once written
+    size_t firstPage = offset * wordSize / pageBytes;
+    size_t lastPage = std::min(((offset + length) * wordSize + pageBytes - 1) / pageBytes, decommittedPages.size());
+    size_t pages = decommittedPages.count(firstPage, lastPage - firstPage);
+
+    if (pages > 0) {
+        decommittedPages.clearRange(firstPage, lastPage - firstPage);
+        decommittedBytes -= pages * pageBytes;
+    }
+}
+
+MemoryManager::HoleIterator MemoryManager::insertHole(HoleIterator position, unsigned int offset, unsigned int length) {
+    auto hole = holeList.insert(position, Hole{ offset, length, 0, scavengeEpoch });
+    indexHole(hole, hole);
+    trackHole(hole);
+
+    return hole;
+}
+
+void MemoryManager::eraseHole(HoleIterator hole) {
+    if (rover == hole) {
+        rover = std::next(hole);
+    }
+
+    untrackHole(hole);
+    indexHole(hole, holeList.end());
+
+    holeList.erase(hole);
+}
+
+void MemoryManager::resizeHole(HoleIterator hole, unsigned int offset, unsigned int length) {
+    untrackHole(hole);
+    indexHole(hole, holeList.end());
+
+    hole->offset = offset;
+    hole->length = length;
+    hole->epoch = scavengeEpoch;
+
+    indexHole(hole, hole);
+    trackHole(hole);
+}
+
+// Engine indexes
+
+void MemoryManager::trackHole(HoleIterator hole) {
+    switch (engine) {
+        case Engine::Strategy:
+            if (sizeIndex == SizeIndex::Table) {
+                holeTable.insert(hole);
+
+            // Recycle the node freed by the last untrack so resizes do not allocate
+            } else if (spareSizeNode) {
+                spareSizeNode.value() = SizeKey{ hole->length, hole->offset, hole };
+                holesBySize.insert(std::move(spareSizeNode));
+            } else {
+                holesBySize.insert(SizeKey{ hole->length, hole->offset, hole });
+            }
+            break;
+
+        case Engine::TLSF:
+            tlsf.insert(hole);
+            break;
+
+        case Engine::WorstFit:
+            holeHeap.insert(hole);
+            break;
+
+        case Engine::Bitmap:
+            // Tracks blocks rather than holes, see allocateFromHole() and coalesce()
+            break;
+    }
+}
+
+// Must be called before the hole's offset or length changes
+void MemoryManager::untrackHole(HoleIterator hole) {
+    switch (engine) {
+        case Engine::Strategy:
+            if (sizeIndex == SizeIndex::Table) {
+                holeTable.erase(hole);
+            } else {
+                spareSizeNode = holesBySize.extract(SizeKey{ hole->length, hole->offset, hole });
+            }
+            break;
+
+        case Engine::TLSF:
+            tlsf.erase(hole);
+            break;
+
+        case Engine::WorstFit:
+            holeHeap.erase(hole);
+            break;
+
+        case Engine::Bitmap:
+            break;
+    }
+}
+
+void MemoryManager::clearTracking() {
+    holesBySize.clear();
+    spareSizeNode = SizeTree::node_type();
+    holeTable.clear();
+    tlsf.clear();
+    holeHeap.clear();
+}
+
+void MemoryManager::indexHole(HoleIterator hole, HoleIterator value) {
+    if (layout == Layout::BoundaryTags) {
+        // Stale tags are simply overwritten by the next owner of those words
+        if (value != holeList.end()) {
+            writeTags(hole->offset, hole->length, 0);
+            std::memcpy(wordAddress(hole->offset + tagWords), &value, sizeof(HoleIterator));
+        }
+
+        return;
+    }
+
+    holeByStart.set(hole->offset, value);
+    holeByEnd.set(hole->offset + hole->length, value);
+
+    if (value != holeList.end()) {
+        holeStarts.set(hole->offset);
+    } else {
+        holeStarts.reset(hole->offset);
+    }
+}
+
+// Faults in the per-word table entries covering the first 'sizeInWords' words
+void MemoryManager::commitTables(size_t sizeInWords) {
+    blockIndex.commit(sizeInWords);
+    holeByStart.commit(sizeInWords + 1);
+    holeByEnd.commit(sizeInWords + 1);
+}
+
+// Boundary tags
+
+void MemoryManager::freeTagged(unsigned int wordOffset) {
+    // Check if address is the payload of an allocated block
+    if (wordOffset < tagWords) {
+        return;
+    }
+
+    unsigned int blockOffset = wordOffset - tagWords;
+    BoundaryTag header = readTag(blockOffset);
+    if (header.allocated != TAG_ALLOCATED) {
+        return;
+    }
+
+    unsigned int blockEnd = blockOffset + header.length;
+    unsigned int numWords = wordsFloor(memoryLimit);
+
+    // Clear the tag first so a repeated free of this address is ignored
+    writeTags(blockOffset, header.length, 0);
+
+    // Neighbours are found through the adjacent footer and header
+    auto left = holeList.end();
+    if (blockOffset > 0) {
+        BoundaryTag footer = readTag(blockOffset - tagWords);
+        if (footer.allocated != TAG_ALLOCATED) {
+            left = readHoleHandle(blockOffset - footer.length);
+        }
+    }
+
+    auto right = holeList.end();
+    if (blockEnd < numWords) {
+        BoundaryTag next = readTag(blockEnd);
+        if (next.allocated != TAG_ALLOCATED) {
+            right = readHoleHandle(blockEnd);
+        }
+    }
+
+    // Order of 'holeList' does not matter here
+    releaseHole(coalesce(blockOffset, header.length, left, right, holeList.end()));
+}
+
+MemoryManager::BoundaryTag MemoryManager::readTag(unsigned int word) {
+    BoundaryTag tag;
+    std::memcpy(&tag, wordAddress(word), sizeof(BoundaryTag));
+    return tag;
+}
+
+void MemoryManager::writeTags(unsigned int offset, unsigned int length, uint32_t allocated) {
+    BoundaryTag tag = { length, allocated };
+
+    std::memcpy(wordAddress(offset), &tag, sizeof(BoundaryTag));
+    std::memcpy(wordAddress(offset + length - tagWords), &tag, sizeof(BoundaryTag));
+}
+
+MemoryManager::HoleIterator MemoryManager::holeAt(unsigned int offset) {
+    return layout == Layout::BoundaryTags ? readHoleHandle(offset) : holeByStart[offset];
+}
+
+MemoryManager::HoleIterator MemoryManager::readHoleHandle(unsigned int offset) {
+    static_assert(std::is_trivially_copyable<HoleIterator>::value, "Hole handles are stored inside the pool");
+
+    HoleIterator hole;
+    std::memcpy(&hole, wordAddress(offset + tagWords), sizeof(HoleIterator));
+    return hole;
+}
+
+uint8_t* MemoryManager::wordAddress(size_t word) {
+    // Widened before scaling, byte offsets of large pools exceed 32 bits
+    return static_cast<uint8_t*>(memoryStart) + word * wordSize;
+}
+
+void MemoryManager::setAllocator(Strategy allocator) {
+    this->allocator = allocator;
+    legacyAllocator = false;
+
+    for (auto& segment : segments) {
+        segment->setAllocator(allocator);
+    }
+
+    // Strategy functions only drive the Strategy engine, rebuild its index when switching
+    if (engine != Engine::Strategy) {
+        clearTracking();
+        engine = Engine::Strategy;
+
+        for (auto hole = holeList.begin(); hole != holeList.end(); ++hole) {
+            trackHole(hole);
+        }
+    }
+}
+
+void MemoryManager::setPages(Pages pages) {
+    preferredPages = pages;
+}
+
+void MemoryManager::setPrefaultTables(bool prefault) {
+    prefaultTables = prefault;
+}
+
+void MemoryManager::setLargeBlockThreshold(size_t bytes) {
+    auto lock = lockAllocator();
+    largeBlockThreshold = bytes;
+}
+
+void MemoryManager::setSizeIndex(SizeIndex index) {
+    auto lock = lockAllocator();
+
+    for (auto& segment : segments) {
+        segment->setSizeIndex(index);
+    }
+
+    if (index == sizeIndex) {
+        return;
+    }
+
+    sizeIndex = index;
+
+    // Only the Strategy engine keeps a size index, the other engines' indexes stay as they are
+    if (engine != Engine::Strategy) {
+        return;
+    }
+
+    holesBySize.clear();
+    spareSizeNode = SizeTree::node_type();
+    holeTable.clear();
+
+    for (auto hole = holeList.begin(); hole != holeList.end(); ++hole) {
+        trackHole(hole);
+    }
+}
+
+void MemoryManager::setReleasePolicy(ReleasePolicy policy) {
+    auto lock = lockAllocator();
+
+    releasePolicy = policy;
+
+    for (auto& segment : segments) {
+        segment->setReleasePolicy(policy);
+    }
+}
+
+void MemoryManager::startScavenger() {
+    startScavenger(ScavengerConfig());
+}
+
+void MemoryManager::startScavenger(ScavengerConfig config) {
+    stopScavenger();
+
+    if (releasePolicy.advice == ReleasePolicy::Advice::None) {
+        throw std::invalid_argument("Expected a release policy with an advice other than None before starting the scavenger");
+    }
+
+    if (config.interval.count() <= 0) {
+        throw std::invalid_argument("Expected a positive scavenger interval, but got " + std::to_string(config.interval.count()) + " ms");
+    }
+
+    scavengerStop = false;
+    scavengerStats = ScavengerStats();
+    setDeferRelease(true);
+    scavengerThread = std::thread(&MemoryManager::runScavenger, this, config);
+}
+
+void MemoryManager::stopScavenger() {
+    if (!scavengerThread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        scavengerStop = true;
+    }
+    scavengerWake.notify_one();
+    scavengerThread.join();
+
+    setDeferRelease(false);
+}
+
+void MemoryManager::setDeferRelease(bool defer) {
+    deferRelease = defer;
+
+    for (auto& segment : segments) {
+        segment->deferRelease = defer;
+    }
+}
+
+std::unique_lock<std::mutex> MemoryManager::lockAllocator() {
+    // Without a scavenger the manager is single-threaded and skips the lock
+    return scavengerThread.joinable() ? std::unique_lock<std::mutex>(mutex) : std::unique_lock<std::mutex>();
+}
+
+void MemoryManager::runScavenger(ScavengerConfig config) {
+    // A hole untouched for this many passes has been idle for at least 'idleTime'
+    auto interval = config.interval.count();
+    unsigned int idleEpochs = static_cast<unsigned int>(std::max<int64_t>(1, (config.idleTime.count() + interval - 1) / interval + 1));
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!scavengerWake.wait_for(lock, config.interval, [this] { return scavengerStop; })) {
+        auto start = std::chrono::steady_clock::now();
+
+        uint64_t holesScanned = 0;
+        size_t released = 0;
+        if (segmentWords != 0) {
+            for (auto& segment : segments) {
+                released += segment->scavenge(idleEpochs, holesScanned);
+            }
+        } else {
+            released = scavenge(idleEpochs, holesScanned);
+        }
+
+        auto end = std::chrono::steady_clock::now();
+
+        scavengerStats.passes++;
+        scavengerStats.holesScanned += holesScanned;
+        scavengerStats.scanNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        scavengerStats.bytesReleased += released;
+    }
+}
+
+// One pass over the holes, called with the allocator lock held; returns the bytes released
+size_t MemoryManager::scavenge(unsigned int idleEpochs, uint64_t& holesScanned) {
+    ++scavengeEpoch;
+
+    size_t released = 0;
+    for (auto hole = holeList.begin(); hole != holeList.end(); ++hole) {
+        ++holesScanned;
+
+        if (scavengeEpoch - hole->epoch >= idleEpochs && size_t(hole->length) * wordSize >= releasePolicy.minHoleBytes) {
+            released += decommitHole(hole);
+        }
+    }
+
+    return released;
+}
+
+void MemoryManager::setAllocator(LegacyStrategy allocator) {
+    // Rejected here rather than in allocate, which fails with nullptr only
+    size_t words = std::max(segmentWords, wordsFloor(reservedLimit));
+    for (const auto& segment : segments) {
+        words = std::max(words, wordsFloor(segment->memoryLimit));
+    }
+
+    if (words > MAX_NUM_WORDS) {
+        throw std::invalid_argument(
+            "Expected a pool of at most " + std::to_string(MAX_NUM_WORDS) + " words for a legacy strategy, but got " + std::to_string(words)
+        );
+    }
+
+    setAllocator(adaptLegacy(allocator));
+    legacyAllocator = true;
+}
+
+void MemoryManager::setAllocator(WideListStrategy allocator) {
+    setAllocator(adaptWideList(allocator));
+}
+
+MemoryManager::Strategy MemoryManager::adaptLegacy(LegacyStrategy allocator) {
+    // Rebuild the '[count, offset, length, ...]' array only for strategies that need it
+    return [allocator](int sizeInWords, const HoleView& holes) {
+        std::vector<uint16_t> list;
+        list.reserve(1 + holes.size() * 2);
+        list.push_back(static_cast<uint16_t>(holes.size()));
+
+        for (auto hole = holes.begin(); hole != holes.end(); ++hole) {
+            list.push_back(static_cast<uint16_t>(hole->offset));
+            list.push_back(static_cast<uint16_t>(holes.usableLength(hole)));
+        }
+
+        int wordOffset = allocator(sizeInWords, list.data());
+
+        // Map the returned offset back to its hole
+        auto it = holes.begin();
+        while (wordOffset != -1 && it != holes.end() && it->offset != static_cast<unsigned int>(wordOffset)) {
+            ++it;
+        }
+
+        return wordOffset == -1 ? holes.end() : it;
+    };
+}
+
+MemoryManager::Strategy MemoryManager::adaptWideList(WideListStrategy allocator) {
+    // Same as 'adaptLegacy' on the '[count, offset, length, ...]' array with 64-bit fields
+    return [allocator](int sizeInWords, const HoleView& holes) {
+        std::vector<uint64_t> list;
+        list.reserve(1 + holes.size() * 2);
+        list.push_back(holes.size());
+
+        for (auto hole = holes.begin(); hole != holes.end(); ++hole) {
+            list.push_back(hole->offset);
+            list.push_back(holes.usableLength(hole));
+        }
+
+        int64_t wordOffset = allocator(sizeInWords, list.data());
+
+        // Map the returned offset back to its hole
+        auto it = holes.begin();
+        while (wordOffset != -1 && it != holes.end() && it->offset != static_cast<uint64_t>(wordOffset)) {
+            ++it;
+        }
+
+        return wordOffset == -1 ? holes.end() : it;
+    };
+}
+
+void MemoryManager::checkFormat(Format format) const {
+    if (format == Format::Compact && poolWords() > MAX_NUM_WORDS) {
+        throw std::runtime_error(
+            "Pool of " + std::to_string(poolWords()) + " words does not fit the compact format, use Format::Wide"
+        );
+    }
+}
+
+template <typename Visit>
+void MemoryManager::forEachHole(Visit visit) const {
+    if (segmentWords == 0) {
+        for (const auto& hole : holeList) {
+            visit(hole.offset, hole.length);
+        }
+        return;
+    }
+
+    // Segments laid end to end in chain order
+    size_t base = 0;
+    for (const auto& segment : segments) {
+        for (const auto& hole : segment->holeList) {
+            visit(base + hole.offset, hole.length);
+        }
+        base += wordsFloor(segment->memoryLimit);
+    }
+}
+
+size_t MemoryManager::holeCount() const {
+    size_t count = holeList.size();
+    for (const auto& segment : segments) {
+        count += segment->holeList.size();
+    }
+    return count;
+}
+
+// Getters
+
+void* MemoryManager::getList(Format format) {
+    auto lock = lockAllocator();
+
+    size_t count = holeCount();
+    if (count == 0) {
+        return nullptr;
+    }
+
+    checkFormat(format);
+
+    if (format == Format::Wide) {
+        uint64_t* list = new uint64_t[1 + count * 2];
+        list[0] = count;
+
+        size_t index = 1;
+        forEachHole([list, &index](size_t offset, size_t length) {
+            list[index++] = offset;
+            list[index++] = length;
+        });
+
+        return list;
+    }
+
+    uint16_t* list = new uint16_t[1 + count * 2];   // 1 for count, 2 per hole
+    list[0] = static_cast<uint16_t>(count);         // Hole count
+
+    size_t index = 1;
+    forEachHole([list, &index](size_t offset, size_t length) {
+        list[index++] = static_cast<uint16_t>(offset);
+        list[index++] = static_cast<uint16_t>(length);
+    });
+
+    return list;
+}
+
+void* MemoryManager::getBitmap(Format format) {
+    auto lock = lockAllocator();
+
+    if (memoryStart == nullptr && segmentWords == 0) {
+        return nullptr;
+    }
+
+    size_t sizeInBytes = bitmapSize(format);
+    uint8_t* bitmap = new uint8_t[sizeInBytes];
+    copyBitmap(bitmap, sizeInBytes, format);
+
+    return bitmap;
+}
+
+size_t MemoryManager::getBitmap(void* buffer, size_t bufferSize, Format format) {
+    auto lock = lockAllocator();
+    return copyBitmap(buffer, bufferSize, format);
+}
+
+size_t MemoryManager::getBitmapSize(Format format) {
+    auto lock = lockAllocator();
+    return bitmapSize(format);
+}
+
+size_t MemoryManager::copyBitmap(void* buffer, size_t bufferSize, Format format) const {
+    size_t sizeInBytes = bitmapSize(format);
+    if (sizeInBytes == 0 || buffer == nullptr || bufferSize < sizeInBytes) {
+        return 0;
+    }
+
+    uint8_t* bitmap = static_cast<uint8_t*>(buffer);
+    size_t headerSize = format == Format::Wide ? 8 : 2;
+    size_t bitmapSizeInBytes = sizeInBytes - headerSize;
+
+    // Little-endian size header
+    for (size_t i = 0; i < headerSize; ++i) {
+        bitmap[i] = static_cast<uint8_t>((bitmapSizeInBytes >> (8 * i)) & 0xFF);
+    }
+
+    // Maintained on every allocate and free, so this is a straight copy
+    if (segmentWords == 0) {
+        allocationBitmap.copyBytes(bitmap + headerSize);
+        return sizeInBytes;
+    }
+
+    // Segments hold whole bytes of bitmap, one copy each
+    uint8_t* destination = bitmap + headerSize;
+    for (const auto& segment : segments) {
+        segment->allocationBitmap.copyBytes(destination);
+        destination += segment->allocationBitmap.size() / 8;
+    }
+
+    return sizeInBytes;
+}
+
+size_t MemoryManager::bitmapSize(Format format) const {
+    if (memoryStart == nullptr && segmentWords == 0) {
+        return 0;
+    }
+
+    checkFormat(format);
+
+    // Size header, then one bit per word rounded up to bytes
+    return (format == Format::Wide ? 8 : 2) + (poolWords() + 7) / 8;
+}
+
+unsigned int MemoryManager::getWordSize() {
+    return wordSize;
+}
+
+void* MemoryManager::getMemoryStart() {
+    auto lock = lockAllocator();
+    return segmentWords != 0 ? segments.front()->memoryStart : memoryStart;
+}
+
+size_t MemoryManager::getMemoryLimit() {
+    auto lock = lockAllocator();
+    return poolWords() * wordSize;
+}
+
+size_t MemoryManager::getReservedLimit() {
+    auto lock = lockAllocator();
+    return segmentWords != 0 ? poolWords() * wordSize : reservedLimit;
+}
+
+MemoryManager::Pages MemoryManager::getPages() {
+    auto lock = lockAllocator();
+    return segmentWords != 0 ? segments.front()->pages : pages;
+}
+
+size_t MemoryManager::getDecommittedBytes() {
+    auto lock = lockAllocator();
+
+    size_t bytes = decommittedBytes;
+    for (const auto& segment : segments) {
+        bytes += segment->decommittedBytes;
+    }
+    return bytes;
+}
+
+size_t MemoryManager::getLargeBlockCount() {
+    auto lock = lockAllocator();
+    return largeBlocks.size();
+}
+
+size_t MemoryManager::getLargeBlockBytes() {
+    auto lock = lockAllocator();
+    return largeBlockBytes;
+}
+
+MemoryManager::ReallocateStats MemoryManager::getReallocateStats() {
+    auto lock = lockAllocator();
+    return reallocateStats;
+}
+
+MemoryManager::ScavengerStats MemoryManager::getScavengerStats() {
+    auto lock = lockAllocator();
+    return scavengerStats;
+}
+
+size_t MemoryManager::getSegmentCount() {
+    auto lock = lockAllocator();
+    return segments.size();
+}
+
+size_t MemoryManager::getMetadataBytesPerBlock() {
+    // Header and footer inside the pool
+    if (layout == Layout::BoundaryTags) {
+        return 2 * tagWords * wordSize;
+    }
+
+    // 'allocatedList' node (payload plus two links), excluding the per-word tables
+    return sizeof(Block) + 2 * sizeof(void*);
+}
+
+// Debugging
+
+int MemoryManager::dumpMemoryMap(char* filename) {
+    auto lock = lockAllocator();
+
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0777);
+
+    if (fd == -1) {
+        return -1;  // Error opening file
+    }
+
+    bool failed = false;
+    bool first = true;
+
+    forEachHole([fd, &failed, &first](size_t offset, size_t length) {
+        if (failed) {
+            return;
+        }
+
+        if (!first) {
+            std::string delim = " - ";
+
+            write(fd, delim.data(), delim.size());
+        }
+        first = false;
+
+        std::string msg = "[" + std::to_string(offset) + ", " + std::to_string(length) + "]";
+
+        if (write(fd, msg.data(), msg.size()) == -1) {
+            failed = true;
+        }
+    });
+
+    if (failed) {
+        if (close(fd) == -1) {
+            return -1;  // Error closing file
+        }
+
+        return -1;  // Error writing to file
+    }
+
+    if (close(fd) == -1) {
+        return -1;  // Error closing file
+    }
+
+    return 0;
+}
+
+// Hole view
+
+MemoryManager::HoleView::const_iterator MemoryManager::HoleView::smallestAtLeast(unsigned int length) const {
+    if (manager->sizeIndex == SizeIndex::Table) {
+        return smallestInTable(length);
+    }
+
+    auto it = manager->holesBySize.lower_bound(SizeKey{ length, 0, {} });
+
+    // Aligned requests: holes shorter than the worst-case slack allows may not fit, longer ones always do.
+    // A few of the shorter ones are probed before settling for the first of the longer ones
+    if (alignment != 0) {
+        size_t sure = length + manager->maxAlignmentSlack(alignment);
+        for (int probes = 0; it != manager->holesBySize.end() && it->length < sure; ++it, ++probes) {
+            if (probes == ALIGNED_PROBES) {
+                it = manager->holesBySize.lower_bound(SizeKey{ static_cast<unsigned int>(std::min<size_t>(sure, UINT_MAX)), 0, {} });
+                break;
+            }
+            if (usableLength(it->hole) >= length) {
+                break;
+            }
+        }
+    }
+
+    return it == manager->holesBySize.end() ? end() : const_iterator(it->hole);
+}
+
+unsigned int MemoryManager::HoleView::usableLength(const_iterator hole) const {
+    size_t slack = manager->alignmentSlack(hole->offset, alignment);
+    return slack < hole->length ? hole->length - static_cast<unsigned int>(slack) : 0;
+}
+
+// Same choice as the tree walk in 'smallestAtLeast()', from a scan of the table
+MemoryManager::HoleView::const_iterator MemoryManager::HoleView::smallestInTable(unsigned int length) const {
+    const auto& table = manager->holeTable;
+
+    if (alignment == 0) {
+        size_t entry = table.smallestAtLeast(length);
+        return entry == HoleTableArrays::NOT_FOUND ? end() : const_iterator(table.at(entry));
+    }
+
+    // The ALIGNED_PROBES smallest holes the tree would probe, in (length, offset) order
+    size_t sure = length + manager->maxAlignmentSlack(alignment);
+    HoleIterator probes[ALIGNED_PROBES];
+    int probed = 0;
+
+    for (size_t entry = 0; entry < table.size(); ++entry) {
+        HoleIterator hole = table.at(entry);
+        if (hole->length < length || hole->length >= sure) {
+            continue;
+        }
+
+        int position = probed;
+        while (position > 0 && (probes[position - 1]->length != hole->length
+                                    ? probes[position - 1]->length > hole->length
+                                    : probes[position - 1]->offset > hole->offset)) {
+            if (position < ALIGNED_PROBES) {
+                probes[position] = probes[position - 1];
+            }
+            --position;
+        }
+
+        if (position < ALIGNED_PROBES) {
+            probes[position] = hole;
+            if (probed < ALIGNED_PROBES) {
+                ++probed;
+            }
+        }
+    }
+
+    for (int probe = 0; probe < probed; ++probe) {
+        if (usableLength(probes[probe]) >= length) {
+            return probes[probe];
+        }
+    }
+
+    size_t entry = table.smallestAtLeast(static_cast<unsigned int>(std::min<size_t>(sure, UINT_MAX)));
+    return entry == HoleTableArrays::NOT_FOUND ? end() : const_iterator(table.at(entry));
+}
+
+MemoryManager::HoleView::const_iterator MemoryManager::HoleView::largest() const {
+    if (manager->sizeIndex == SizeIndex::Table) {
+        size_t entry = manager->holeTable.largest();
+        return entry == HoleTableArrays::NOT_FOUND ? end() : const_iterator(manager->holeTable.at(entry));
+    }
+
+    if (manager->holesBySize.empty()) {
+        return end();
+    }
+
+    // Lowest offset among the largest holes
+    unsigned int length = manager->holesBySize.rbegin()->length;
+    return manager->holesBySize.lower_bound(SizeKey{ length, 0, {} })->hole;
+}
+
+// Allocators
+
+MemoryManager::HoleView::const_iterator bestFit(int sizeInWords, const MemoryManager::HoleView& holes) {
+    // Smallest suitable hole, lowest offset on ties
+    return holes.smallestAtLeast(sizeInWords);
+}
+
+MemoryManager::HoleView::const_iterator worstFit(int sizeInWords, const MemoryManager::HoleView& holes) {
+    // Largest hole, lowest offset on ties
+    auto largest = holes.largest();
+
+    // Check if largest hole suitable
+    if (largest == holes.end() || holes.usableLength(largest) < static_cast<unsigned int>(sizeInWords)) {
+        return holes.end();
+    }
+
+    return largest;
+}
+
+MemoryManager::HoleView::const_iterator firstFit(int sizeInWords, const MemoryManager::HoleView& holes) {
+    // First suitable hole in list order, the lowest-addressed one unless boundary tags are used
+    for (auto hole = holes.begin(); hole != holes.end(); ++hole) {
+        if (holes.usableLength(hole) >= static_cast<unsigned int>(sizeInWords)) {
+            return hole;
+        }
+    }
+
+    return holes.end();
+}
+
+MemoryManager::HoleView::const_iterator nextFit(int sizeInWords, const MemoryManager::HoleView& holes) {
+    // First suitable hole from the rover on, wrapping around to the front of the list
+    auto start = holes.rover();
+
+    for (auto hole = start; hole != holes.end(); ++hole) {
+        if (holes.usableLength(hole) >= static_cast<unsigned int>(sizeInWords)) {
+            return hole;
+        }
+    }
+
+    for (auto hole = holes.begin(); hole != start; ++hole) {
+        if (holes.usableLength(hole) >= static_cast<unsigned int>(sizeInWords)) {
+            return hole;
+        }
+    }
+
+    return holes.end();
+}
+
+int64_t bestFitWide(size_t sizeInWords, const uint64_t* list) {
+    int64_t bestOffset = -1;
+    uint64_t bestLength = UINT64_MAX;
+
+    // Smallest suitable hole, first in list order on ties
+    for (uint64_t i = 0; i < list[0]; ++i) {
+        uint64_t length = list[2 + 2 * i];
+        if (length >= sizeInWords && length < bestLength) {
+            bestOffset = static_cast<int64_t>(list[1 + 2 * i]);
+            bestLength = length;
+        }
+    }
+
+    return bestOffset;
+}
+
+int64_t worstFitWide(size_t sizeInWords, const uint64_t* list) {
+    int64_t worstOffset = -1;
+    uint64_t worstLength = 0;
+
+    // Largest hole, first in list order on ties
+    for (uint64_t i = 0; i < list[0]; ++i) {
+        uint64_t length = list[2 + 2 * i];
+        if (length > worstLength) {
+            worstOffset = static_cast<int64_t>(list[1 + 2 * i]);
+            worstLength = length;
+        }
+    }
+
+    return worstLength >= sizeInWords ? worstOffset : -1;
 }
@@ -1,57 +1,379 @@
 #ifndef MEMORY_MANAGER_H
 #define MEMORY_MANAGER_H
 
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include "AllocationBitmap.h"
+#include "HoleTable.h"
+#include "MaxHeap.h"
+#include "NodePool.h"
+#include "SummaryBitmap.h"
+#include "Tlsf.h"
+#include "WordTable.h"
 
 class MemoryManager {
 public:
-    static const unsigned int MAX_NUM_WORDS = 65535;
+    static const unsigned int MAX_NUM_WORDS = 65535;         // Largest pool the compact formats describe
+    static const size_t MAX_WIDE_NUM_WORDS = 0xFFFFFFFF;    // Largest pool, 32-bit word offsets
 
-    MemoryManager(unsigned int wordSize, std::function<int(int, void*)> allocator);
+    // Field width of the 'getList()' and 'getBitmap()' arrays
+    enum class Format {
+        Compact,    // 16-bit fields, pools up to MAX_NUM_WORDS
+        Wide        // 64-bit fields, any pool
+    };
+
+    // Allocation engine, fixed at construction
+    enum class Engine {
+        Strategy,   // Driven by the configured allocator function
+        TLSF,       // Two-level segregated fit, O(1) hole lookup
+        WorstFit,   // Max-heap of holes, O(1) largest-hole lookup
+        Bitmap      // Allocation bitmap with SIMD free-run search, first fit
+    };
+
+    // Index behind the Strategy engine's size-ordered lookups ('smallestAtLeast()' and 'largest()')
+    enum class SizeIndex {
+        Tree,       // Ordered set of holes, O(log n) lookups
+        Table       // Structure-of-arrays hole table, linear AVX2 scans; faster with few holes
+    };
+
+    // Where block metadata lives, fixed at initialize()
+    enum class Layout {
+        OutOfBand,      // Lists and per-word tables beside the pool
+        BoundaryTags    // Header/footer tags inside the pool around every block
+    };
+
+    // Page backing of the pool mapping
+    enum class Pages {
+        Standard,       // Base pages
+        HugeTlb,        // Reserved huge pages (MAP_HUGETLB), falls back to Transparent
+        Transparent     // 2 MiB-aligned mapping with MADV_HUGEPAGE, falls back to Standard
+    };
+
+    // Returning the interior of large holes to the OS, applied on free() or by the scavenger
+    struct ReleasePolicy {
+        enum class Advice {
+            None,       // Keep freed memory resident
+            DontNeed,   // madvise(MADV_DONTNEED), released at once
+            Free        // madvise(MADV_FREE), reclaimed lazily under memory pressure
+        };
+
+        Advice advice = Advice::None;
+        size_t minHoleBytes = size_t(1) << 20;      // Smaller holes are left alone
+        size_t minReleaseBytes = size_t(256) << 10; // Resident bytes a hole must regain before it is released again
+    };
+
+    // Background thread applying the release policy to idle holes instead of free()
+    struct ScavengerConfig {
+        std::chrono::milliseconds interval{ 100 };     // Time between passes
+        std::chrono::milliseconds idleTime{ 1000 };    // Holes unchanged this long are released
+    };
+
+    struct ScavengerStats {
+        uint64_t passes = 0;
+        uint64_t holesScanned = 0;
+        uint64_t scanNanoseconds = 0;   // Time the passes held the allocator lock
+        uint64_t bytesReleased = 0;
+    };
+
+    // Outcomes of 'reallocate()'; a new size that rounds to the block's current words counts in none
+    struct ReallocateStats {
+        uint64_t grownInPlace = 0;      // Extended into the following hole
+        uint64_t shrunkInPlace = 0;     // Tail returned to the hole list, or kept if too small
+        uint64_t moved = 0;             // Allocated elsewhere, copied and freed
+        uint64_t remapped = 0;          // Large block resized with mremap, no copy
+    };
+
+    // Free region of the pool, in words
+    struct Hole {
+        unsigned int offset;
+        unsigned int length;
+        unsigned int slot;      // Position within the engine's index
+        unsigned int epoch;     // Scavenger pass during which the hole last changed
+    };
+
+    using HoleList = std::list<Hole, PoolAllocator<Hole>>;
+
+    // Read-only view over the manager's own hole list (address-ordered unless boundary tags are used)
+    class HoleView {
+    public:
+        using const_iterator = HoleList::const_iterator;
+
+        const_iterator begin() const { return manager->holeList.begin(); }
+        const_iterator end() const { return manager->holeList.end(); }
+        size_t size() const { return manager->holeList.size(); }
+        bool empty() const { return manager->holeList.empty(); }
+
+        // Words left in 'hole' once an aligned request skips its leading slack; the whole length otherwise
+        unsigned int usableLength(const_iterator hole) const;
+
+        // Size-ordered lookups, ties go to the lowest offset; 'end()' if none
+        const_iterator smallestAtLeast(unsigned int length) const;  // By usable length
+        const_iterator largest() const;
+
+        // Hole the last block was carved from, or the hole after it once that one is used up; 'end()' initially
+        const_iterator rover() const { return manager->rover; }
+
+    private:
+        friend class MemoryManager;
+
+        static const int ALIGNED_PROBES = 16;  // Short holes 'smallestAtLeast' checks for an aligned fit
+
+        HoleView(const MemoryManager& manager, size_t alignment = 0) : manager(&manager), alignment(alignment) {}
+
+        const_iterator smallestInTable(unsigned int length) const;
+
+        const MemoryManager* manager;
+        size_t alignment;   // Of the request being placed, 0 if none
+    };
+
+    // Returns the chosen hole, or 'holes.end()' if none fits
+    using Strategy = std::function<HoleView::const_iterator(int, const HoleView&)>;
+
+    // Legacy strategy operating on a copied 'getList()' array
+    using LegacyStrategy = std::function<int(int, void*)>;
+
+    // Strategy operating on a copied 'getList(Format::Wide)' array; returns an offset or -1
+    using WideListStrategy = std::function<int64_t(size_t, const uint64_t*)>;
+
+    MemoryManager(unsigned int wordSize, Strategy allocator);
+    MemoryManager(unsigned int wordSize, LegacyStrategy allocator);
+    MemoryManager(unsigned int wordSize, WideListStrategy allocator);
+    MemoryManager(unsigned int wordSize, Engine engine);
     ~MemoryManager();
 
     // Core functionality
-    void initialize(size_t sizeInWords);
+    void initialize(size_t sizeInWords, Layout layout = Layout::OutOfBand);
+    void initializeGrowable(size_t sizeInWords, size_t reservedWords, Layout layout = Layout::OutOfBand);
+    void initializeSegmented(size_t segmentWords, Layout layout = Layout::OutOfBand);
     void shutdown();
     void* allocate(size_t sizeInBytes);
+    void* allocateAligned(size_t sizeInBytes, size_t alignment);    // Power-of-two 'alignment' in bytes
     void free(void* address);
-    void setAllocator(std::function<int(int, void*)> allocator);
+    void* reallocate(void* address, size_t newSizeInBytes);   // Grows or shrinks in place when it can, like realloc otherwise
+    void setAllocator(Strategy allocator);
+    void setAllocator(LegacyStrategy allocator);
+    void setAllocator(WideListStrategy allocator);
+    void setPages(Pages pages);     // Applies from the next initialize
+    void setPrefaultTables(bool prefault);      // Applies from the next initialize, out-of-band layout only
+    void setReleasePolicy(ReleasePolicy policy);
+    void setLargeBlockThreshold(size_t bytes);  // Requests of at least 'bytes' are mapped outside the pool, 0 disables
+    void setSizeIndex(SizeIndex index);         // Same placement with either index
+
+    // Allocator calls are serialized with the scavenger while it runs; start and stop
+    // must not race with other calls, and initialize/shutdown stop it
+    void startScavenger();
+    void startScavenger(ScavengerConfig config);
+    void stopScavenger();
 
     // Getters
-    void* getList();
-    void* getBitmap();
+    void* getList(Format format = Format::Compact);
+    void* getBitmap(Format format = Format::Compact);
+    size_t getBitmap(void* buffer, size_t bufferSize, Format format = Format::Compact);
+    size_t getBitmapSize(Format format = Format::Compact);
     unsigned int getWordSize();
     void* getMemoryStart();
-    unsigned int getMemoryLimit();
+    size_t getMemoryLimit();
+    size_t getReservedLimit();
+    size_t getSegmentCount();
+    Pages getPages();               // Backing actually obtained
+    size_t getDecommittedBytes();   // Hole bytes currently handed back to the OS
+    ScavengerStats getScavengerStats();
+    ReallocateStats getReallocateStats();
+    size_t getLargeBlockCount();    // Blocks mapped outside the pool
+    size_t getLargeBlockBytes();    // Bytes those mappings span
+    size_t getMetadataBytesPerBlock();
 
     // Debugging
     int dumpMemoryMap(char* filename);
 
+protected:
+    // Allocation with the hole chosen by an inlined 'select' and a compile-time word size, see BasicMemoryManager.h
+    template <unsigned int WordSize, typename Select>
+    void* allocateWith(size_t sizeInBytes, Select select);
+
 private:
-    struct Hole {
+    struct Block {
         unsigned int offset;
         unsigned int length;
     };
 
-    struct Block {
-        unsigned int offset;
+    using HoleIterator = HoleList::iterator;
+    using BlockIterator = std::list<Block, PoolAllocator<Block>>::iterator;
+
+    // Header and footer of every block in the boundary-tag layout; free blocks
+    // also store their 'holeList' handle right after the header
+    struct BoundaryTag {
+        uint32_t length;        // Whole block in words, tags included
+        uint32_t allocated;     // TAG_ALLOCATED or 0
+    };
+
+    static const uint32_t TAG_ALLOCATED = 0xA110CA7E;
+
+    enum class Resize {
+        Grown,
+        Shrunk,
+        Unchanged,  // The block's words already fit the new size exactly
+        NoRoom,     // The following hole is missing or too short
+        NotABlock
+    };
+
+    // Entry of the size-ordered hole index
+    struct SizeKey {
         unsigned int length;
+        unsigned int offset;
+        HoleIterator hole;
+
+        bool operator<(const SizeKey& other) const {
+            return length != other.length ? length < other.length : offset < other.offset;
+        }
     };
 
+    using SizeTree = std::set<SizeKey, std::less<SizeKey>, PoolAllocator<SizeKey>>;
+
     unsigned int wordSize;
+    int wordShift;                  // log2(wordSize) for powers of two, -1 otherwise
     void* memoryStart;
-    size_t memoryLimit;
-    std::function<int(int, void*)> allocator;
-    std::list<Hole> holeList;
-    std::list<Block> allocatedList;
+    size_t memoryLimit;             // Committed bytes
+    size_t reservedLimit;           // Reserved bytes, equal to 'memoryLimit' unless growable
+    size_t mappedBytes = 0;         // Length of the mapping, 'reservedLimit' rounded up to whole pages
+    size_t pageBytes = 0;           // Commit granularity of the backing
+    Pages preferredPages = Pages::Standard;
+    bool prefaultTables = false;    // Back the per-word tables of the committed pool up front
+    Pages pages = Pages::Standard;
+    ReleasePolicy releasePolicy;
+    AllocationBitmap decommittedPages;      // 1 bit per page of the mapping, set once released
+    size_t decommittedBytes = 0;
+    ReallocateStats reallocateStats;
+    size_t largeBlockThreshold = 0;
+    std::map<uintptr_t, size_t> largeBlocks;    // Out-of-pool blocks, start to mapped bytes
+    size_t largeBlockBytes = 0;
+    Strategy allocator;
+    bool legacyAllocator = false;   // 'allocator' adapts a LegacyStrategy, pools are limited to MAX_NUM_WORDS
+    Engine engine;
+    Layout layout;
+    unsigned int tagWords;          // Words per header or footer
+    unsigned int minBlockWords;     // Smallest block able to hold tags and a hole handle
+
+    // List and index nodes come from pools owned by the manager, declared first so they outlive the containers
+    NodePool holeNodes;
+    NodePool blockNodes;
+    NodePool sizeNodes;
+    HoleList holeList{ PoolAllocator<Hole>(&holeNodes) };
+    HoleIterator rover = holeList.end();    // See 'HoleView::rover()', moved off holes as they are erased
+    std::list<Block, PoolAllocator<Block>> allocatedList{ PoolAllocator<Block>(&blockNodes) };
+    Tlsf<HoleIterator> tlsf;
+    MaxHeap<HoleIterator> holeHeap;
+    AllocationBitmap allocationBitmap;              // 1 bit per word, searched by the Bitmap engine
+    SizeIndex sizeIndex = SizeIndex::Tree;
+    SizeTree holesBySize{ PoolAllocator<SizeKey>(&sizeNodes) };      // Strategy engine index, SizeIndex::Tree
+    SizeTree::node_type spareSizeNode;                              // Reused across resizes
+    HoleTable<HoleIterator> holeTable;                              // Strategy engine index, SizeIndex::Table
+
+    // Segmented pools chain independent single-mapping managers ('segmentWords' 0 otherwise)
+    size_t segmentWords = 0;                                    // Default segment size
+    std::vector<std::unique_ptr<MemoryManager>> segments;       // Chain order
+    std::map<uintptr_t, MemoryManager*> segmentByAddress;       // Keyed by segment start
+    MemoryManager* currentSegment = nullptr;                    // Served the last request, tried first
+
+    // Scavenger thread, 'mutex' is only taken while it runs
+    std::thread scavengerThread;
+    std::mutex mutex;
+    std::condition_variable scavengerWake;
+    bool scavengerStop = false;
+    ScavengerStats scavengerStats;
+    bool deferRelease = false;          // free() leaves releasing to the scavenger
+    unsigned int scavengeEpoch = 0;     // Passes over this manager's holes so far
 
-    void mergeHoles();
+    // Offset-indexed lookup tables over the whole reservation, one entry per word ('end()' when empty)
+    WordTable<BlockIterator> blockIndex;    // Block starting at word
+    WordTable<HoleIterator> holeByStart;    // Hole starting at word
+    WordTable<HoleIterator> holeByEnd;      // Hole ending just before word
+    SummaryBitmap holeStarts;               // Set at every hole start, for next-hole search
+
+    std::unique_lock<std::mutex> lockAllocator();
+    void runScavenger(ScavengerConfig config);
+    size_t scavenge(unsigned int idleEpochs, uint64_t& holesScanned);
+    void setDeferRelease(bool defer);
+
+    size_t wordsFloor(size_t bytes) const;
+    size_t wordsCeil(size_t bytes) const;
+    bool isWordAligned(size_t bytes) const;
+
+    bool mapPool();
+    size_t roundToPage(size_t bytes) const;
+    void setLayout(Layout layout);
+    void* allocateBytes(size_t sizeInBytes, size_t alignment);
+    void* allocateWords(unsigned int sizeInWords, size_t alignment);
+    void* allocateSegmented(size_t sizeInBytes, size_t alignment);
+    MemoryManager* addSegment(size_t sizeInWords);
+    MemoryManager* segmentOf(void* address);
+    void releaseSegment(MemoryManager* segment);
+    bool isEmpty() const;
+    size_t maxPoolWords() const;
+    size_t poolWords() const;
+    bool grow(size_t minimumWords);
+    void* allocateFromHole(HoleIterator hole, unsigned int sizeInWords);
+    void* allocateAligned(HoleIterator hole, unsigned int sizeInWords, size_t alignment);
+    HoleIterator firstAlignedFit(unsigned int sizeInWords, size_t alignment);
+    size_t alignmentSlack(size_t offset, size_t alignment) const;
+    size_t wordsToAlignment(size_t offset, size_t alignment) const;
+    size_t alignmentStride(size_t alignment) const;
+    size_t maxAlignmentSlack(size_t alignment) const;
+    HoleIterator insertHole(HoleIterator position, unsigned int offset, unsigned int length);
+    void eraseHole(HoleIterator hole);
+    void resizeHole(HoleIterator hole, unsigned int offset, unsigned int length);
+    void indexHole(HoleIterator hole, HoleIterator value);
+    void commitTables(size_t sizeInWords);
+    void trackHole(HoleIterator hole);
+    void untrackHole(HoleIterator hole);
+    void clearTracking();
+    HoleIterator coalesce(unsigned int offset, unsigned int length, HoleIterator left, HoleIterator right, HoleIterator position);
+    void releaseHole(HoleIterator hole);
+    size_t decommitHole(HoleIterator hole);
+    void recommit(size_t offset, size_t length);
+    void freeBlock(void* address);
+    void* allocateLarge(size_t sizeInBytes);
+    void* reallocateLarge(std::map<uintptr_t, size_t>::iterator large, size_t newSizeInBytes);
+    bool freeLarge(void* address);
+    void freeTagged(unsigned int wordOffset);
+    Resize resizeBlock(void* address, size_t newSizeInBytes, size_t& oldSizeInBytes);
+
+    BoundaryTag readTag(unsigned int word);
+    void writeTags(unsigned int offset, unsigned int length, uint32_t allocated);
+    HoleIterator holeAt(unsigned int offset);
+    HoleIterator readHoleHandle(unsigned int offset);
+    uint8_t* wordAddress(size_t word);
+
+    size_t bitmapSize(Format format) const;
+    size_t copyBitmap(void* buffer, size_t bufferSize, Format format) const;
+    void checkFormat(Format format) const;
+    size_t holeCount() const;
+
+    template <typename Visit>
+    void forEachHole(Visit visit) const;
+
+    static Strategy adaptLegacy(LegacyStrategy allocator);
+    static Strategy adaptWideList(WideListStrategy allocator);
 };
 
 // Allocation strategies
-int bestFit(int sizeInWords, void* list);
-int worstFit(int sizeInWords, void* list);
+MemoryManager::HoleView::const_iterator bestFit(int sizeInWords, const MemoryManager::HoleView& holes);
+MemoryManager::HoleView::const_iterator worstFit(int sizeInWords, const MemoryManager::HoleView& holes);
+MemoryManager::HoleView::const_iterator firstFit(int sizeInWords, const MemoryManager::HoleView& holes);
+MemoryManager::HoleView::const_iterator nextFit(int sizeInWords, const MemoryManager::HoleView& holes);
+
+// Allocation strategies on the wide 'getList()' array
+int64_t bestFitWide(size_t sizeInWords, const uint64_t* list);
+int64_t worstFitWide(size_t sizeInWords, const uint64_t* list);
 
 #endif // MEMORY_MANAGER_H
@@ -0,0 +1,132 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Fixed-size node storage for one node-based container.
+//
+// Nodes are carved in order from chunks that double in size up to MAX_CHUNK_NODES
+// and are recycled through an intrusive free list, so inserts and erases in the
+// steady state never reach the global heap and nodes created together sit side by
+// side. The node size is fixed by the first request; other sizes go to the global
+// heap.
+class NodePool {
+public:
+    static const size_t FIRST_CHUNK_NODES = 64;
+    static const size_t MAX_CHUNK_NODES = 4096;
+
+    NodePool() = default;
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    void* allocate(size_t bytes) {
+        if (requestBytes == 0) {
+            requestBytes = bytes;
+            nodeBytes = bytes < sizeof(FreeNode) ? sizeof(FreeNode) : bytes;
+        }
+        if (bytes != requestBytes) {
+            return ::operator new(bytes);
+        }
+
+        if (freeNodes != nullptr) {
+            FreeNode* node = freeNodes;
+            freeNodes = node->next;
+            return node;
+        }
+
+        if (cursor == chunkEnd) {
+            addChunk();
+        }
+
+        void* node = cursor;
+        cursor += nodeBytes;
+        return node;
+    }
+
+    void deallocate(void* node, size_t bytes) {
+        if (bytes != requestBytes) {
+            ::operator delete(node);
+            return;
+        }
+
+        freeNodes = ::new (node) FreeNode{ freeNodes };
+    }
+
+    // Returns the chunks to the global heap; every node must have been deallocated
+    void release() {
+        chunks.clear();
+        chunks.shrink_to_fit();
+        freeNodes = nullptr;
+        cursor = nullptr;
+        chunkEnd = nullptr;
+        capacity = 0;
+    }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    size_t requestBytes = 0;        // Node size served from the chunks
+    size_t nodeBytes = 0;           // Stride, large enough for the free-list link
+    FreeNode* freeNodes = nullptr;
+    uint8_t* cursor = nullptr;      // Next uncarved node of the newest chunk
+    uint8_t* chunkEnd = nullptr;
+    size_t capacity = 0;            // Nodes in all chunks
+    std::vector<std::unique_ptr<uint8_t[]>> chunks;
+
+    void addChunk() {
+        size_t nodes = capacity == 0 ? FIRST_CHUNK_NODES : capacity < MAX_CHUNK_NODES ? capacity : MAX_CHUNK_NODES;
+        chunks.emplace_back(new uint8_t[nodes * nodeBytes]);
+        cursor = chunks.back().get();
+        chunkEnd = cursor + nodes * nodeBytes;
+        capacity += nodes;
+    }
+};
+
+// Standard allocator handing out single nodes from a NodePool
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    static_assert(alignof(T) <= alignof(std::max_align_t), "Pool nodes are only aligned for fundamental types");
+
+    explicit PoolAllocator(NodePool* pool) : pool(pool) {}
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+
+    T* allocate(size_t count) {
+        if (count != 1) {
+            return static_cast<T*>(::operator new(count * sizeof(T)));
+        }
+        return static_cast<T*>(pool->allocate(sizeof(T)));
+    }
+
+    void deallocate(T* node, size_t count) {
+        if (count != 1) {
+            ::operator delete(node);
+            return;
+        }
+        pool->deallocate(node, sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>& other) const { return pool == other.pool; }
+
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>& other) const { return pool != other.pool; }
+
+private:
+    template <typename U>
+    friend class PoolAllocator;
+
+    NodePool* pool;
+};
+
+#endif // NODE_POOL_H
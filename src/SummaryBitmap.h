@@ -0,0 +1,84 @@
+#ifndef SUMMARY_BITMAP_H
+#define SUMMARY_BITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bitmap with one summary bit per 64-bit word, so searching for the next set bit
+// skips 4096 clear bits at a time.
+class SummaryBitmap {
+public:
+    void assign(size_t numBits) {
+        this->numBits = numBits;
+        bits.assign((numBits + 63) / 64, 0);
+        summary.assign((bits.size() + 63) / 64, 0);
+    }
+
+    // Keeps existing bits, new bits start clear
+    void resize(size_t numBits) {
+        this->numBits = numBits;
+        bits.resize((numBits + 63) / 64, 0);
+        summary.resize((bits.size() + 63) / 64, 0);
+    }
+
+    void clear() {
+        numBits = 0;
+        bits.clear();
+        bits.shrink_to_fit();
+        summary.clear();
+        summary.shrink_to_fit();
+    }
+
+    void set(size_t index) {
+        bits[index / 64] |= uint64_t(1) << (index % 64);
+        summary[index / 4096] |= uint64_t(1) << ((index / 64) % 64);
+    }
+
+    void reset(size_t index) {
+        bits[index / 64] &= ~(uint64_t(1) << (index % 64));
+        if (bits[index / 64] == 0) {
+            summary[index / 4096] &= ~(uint64_t(1) << ((index / 64) % 64));
+        }
+    }
+
+    // Returns the first set bit at or after 'index', or 'size()' if none
+    size_t findNext(size_t index) const {
+        if (index >= numBits) {
+            return numBits;
+        }
+
+        size_t word = index / 64;
+        uint64_t masked = bits[word] & (~uint64_t(0) << (index % 64));
+        if (masked != 0) {
+            return word * 64 + __builtin_ctzll(masked);
+        }
+
+        // Next non-empty word via the summary
+        size_t next = word + 1;
+        if (next >= bits.size()) {
+            return numBits;
+        }
+
+        size_t group = next / 64;
+        uint64_t groupMask = summary[group] & (~uint64_t(0) << (next % 64));
+        while (groupMask == 0) {
+            if (++group >= summary.size()) {
+                return numBits;
+            }
+            groupMask = summary[group];
+        }
+
+        word = group * 64 + __builtin_ctzll(groupMask);
+        return word * 64 + __builtin_ctzll(bits[word]);
+    }
+
+    size_t size() const { return numBits; }
+
+private:
+    size_t numBits = 0;
+    std::vector<uint64_t> bits;
+    std::vector<uint64_t> summary;
+};
+
+#endif // SUMMARY_BITMAP_H
@@ -0,0 +1,135 @@
+#ifndef TLSF_H
+#define TLSF_H
+
+#include <cstdint>
+#include <vector>
+
+// Two-level segregated fit (TLSF) index over free holes.
+//
+// Holes are binned by length into first-level (power of two) classes, each split
+// into SL_COUNT linear second-level classes. One bitmap per level records which
+// classes are non-empty, so locating a class that is guaranteed to satisfy a
+// request takes two bit scans no matter how many holes exist.
+//
+// 'Handle' must dereference to a hole exposing 'length' and 'slot'. The index owns
+// 'slot' (the handle's position within its bin) while the handle is inserted.
+template <typename Handle>
+class Tlsf {
+public:
+    static const unsigned int SL_BITS = 4;
+    static const unsigned int SL_COUNT = 1u << SL_BITS;
+    static const unsigned int FL_COUNT = 32 - SL_BITS + 1;
+    static const unsigned int FALLBACK_PROBES = 8;
+
+    Tlsf() { clear(); }
+
+    void clear() {
+        flBitmap = 0;
+        for (unsigned int fl = 0; fl < FL_COUNT; ++fl) {
+            slBitmap[fl] = 0;
+            for (unsigned int sl = 0; sl < SL_COUNT; ++sl) {
+                bins[fl][sl].clear();
+            }
+        }
+    }
+
+    void insert(Handle handle) {
+        unsigned int fl, sl;
+        mapping(handle->length, fl, sl);
+
+        std::vector<Handle>& bin = bins[fl][sl];
+        handle->slot = static_cast<unsigned int>(bin.size());
+        bin.push_back(handle);
+
+        slBitmap[fl] |= (1u << sl);
+        flBitmap |= (1u << fl);
+    }
+
+    // Must be called before the hole's length changes
+    void erase(Handle handle) {
+        unsigned int fl, sl;
+        mapping(handle->length, fl, sl);
+
+        // Swap with last entry so removal is O(1)
+        std::vector<Handle>& bin = bins[fl][sl];
+        Handle last = bin.back();
+        bin[handle->slot] = last;
+        last->slot = handle->slot;
+        bin.pop_back();
+
+        if (bin.empty()) {
+            slBitmap[fl] &= ~(1u << sl);
+            if (slBitmap[fl] == 0) {
+                flBitmap &= ~(1u << fl);
+            }
+        }
+    }
+
+    // Finds a hole of at least 'size' units. Returns false if no larger class has one and
+    // none of the FALLBACK_PROBES newest holes of the request's own class fits, even if an
+    // older hole of that class would
+    bool find(unsigned int size, Handle& handle) const {
+        unsigned int fl, sl;
+
+        // Round up to the next class boundary so every hole in the class fits
+        uint64_t rounded = size;
+        if (size >= SL_COUNT) {
+            rounded += (uint64_t(1) << (msb(size) - SL_BITS)) - 1;
+        }
+
+        if (rounded <= UINT32_MAX) {
+            mapping(static_cast<unsigned int>(rounded), fl, sl);
+
+            uint32_t slMap = slBitmap[fl] & (~0u << sl);
+            if (slMap == 0) {
+                uint32_t flMap = (fl + 1 < 32) ? (flBitmap & (~0u << (fl + 1))) : 0;
+                if (flMap != 0) {
+                    fl = __builtin_ctz(flMap);
+                    slMap = slBitmap[fl];
+                }
+            }
+
+            if (slMap != 0) {
+                sl = __builtin_ctz(slMap);
+                handle = bins[fl][sl].back();
+                return true;
+            }
+        }
+
+        // Nothing in a larger class; the request's own class may still hold a fit, but only its
+        // newest FALLBACK_PROBES holes are tried so the lookup stays constant time
+        mapping(size, fl, sl);
+        const std::vector<Handle>& bin = bins[fl][sl];
+        size_t probes = 0;
+        for (auto it = bin.rbegin(); it != bin.rend() && probes < FALLBACK_PROBES; ++it, ++probes) {
+            if ((*it)->length >= size) {
+                handle = *it;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    uint32_t flBitmap;
+    uint32_t slBitmap[FL_COUNT];
+    std::vector<Handle> bins[FL_COUNT][SL_COUNT];
+
+    static unsigned int msb(unsigned int value) {
+        return 31 - __builtin_clz(value);
+    }
+
+    static void mapping(unsigned int size, unsigned int& fl, unsigned int& sl) {
+        if (size < SL_COUNT) {
+            fl = 0;
+            sl = size;
+        } else {
+            unsigned int bit = msb(size);
+            fl = bit - SL_BITS + 1;
+            sl = (size >> (bit - SL_BITS)) - SL_COUNT;
+        }
+    }
+};
+
+#endif // TLSF_H
@@ -0,0 +1,124 @@
+#ifndef WORD_TABLE_H
+#define WORD_TABLE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Word-indexed table of handles in zeroed anonymous memory.
+//
+// The whole range is reserved with MAP_NORESERVE and the kernel backs a page only once
+// it is written, so a table costs resident memory in proportion to the words used as
+// block or hole boundaries. commit() faults a prefix in up front instead, trading that
+// memory for allocate and free never taking a first-touch page fault. All-zero entries are empty and read back as the 'empty' handle given
+// to assign(); storing 'empty' clears the entry. 'T' must be trivially copyable, and
+// no other handle may be all zero bits.
+template <typename T>
+class WordTable {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "Entries are read and written as raw bytes");
+
+    WordTable() = default;
+    WordTable(const WordTable&) = delete;
+    WordTable& operator=(const WordTable&) = delete;
+
+    ~WordTable() { release(); }
+
+    // Maps 'count' empty entries; returns false if the mapping fails
+    bool assign(size_t count, T empty) {
+        release();
+
+        if (count == 0) {
+            this->empty = empty;
+            return true;
+        }
+
+        void* mapping = mmap(nullptr, count * sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mapping == MAP_FAILED) {
+            return false;
+        }
+
+        entries = static_cast<uint8_t*>(mapping);
+        entryCount = count;
+        this->empty = empty;
+        return true;
+    }
+
+    // Faults in the pages holding the first 'count' entries; entries already committed stay as they are
+    void commit(size_t count) {
+        size_t pageBytes = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t start = roundToPage(committedCount * sizeof(T), pageBytes);
+        size_t end = std::min(roundToPage(count * sizeof(T), pageBytes), roundToPage(entryCount * sizeof(T), pageBytes));
+
+        if (end > start) {
+            bool populated = false;
+#ifdef MADV_POPULATE_WRITE
+            // Older kernels reject MADV_POPULATE_WRITE
+            populated = madvise(entries + start, end - start, MADV_POPULATE_WRITE) == 0;
+#endif
+            // No entry past the committed pages has been written, so zeroing them loses nothing
+            if (!populated) {
+                std::memset(entries + start, 0, end - start);
+            }
+        }
+
+        committedCount = std::max(committedCount, count);
+    }
+
+    void release() {
+        if (entries != nullptr) {
+            munmap(entries, entryCount * sizeof(T));
+        }
+
+        entries = nullptr;
+        entryCount = 0;
+        committedCount = 0;
+    }
+
+    T operator[](size_t word) const {
+        const uint8_t* entry = entries + word * sizeof(T);
+        if (isZero(entry)) {
+            return empty;
+        }
+
+        T value;
+        std::memcpy(&value, entry, sizeof(T));
+        return value;
+    }
+
+    void set(size_t word, T value) {
+        uint8_t* entry = entries + word * sizeof(T);
+        if (value == empty) {
+            // An entry that was never written stays unbacked
+            if (!isZero(entry)) {
+                std::memset(entry, 0, sizeof(T));
+            }
+            return;
+        }
+
+        std::memcpy(entry, &value, sizeof(T));
+    }
+
+    size_t size() const { return entryCount; }
+
+private:
+    uint8_t* entries = nullptr;
+    size_t entryCount = 0;
+    size_t committedCount = 0;  // Entries whose pages commit() has faulted in
+    T empty{};
+
+    static size_t roundToPage(size_t bytes, size_t pageBytes) {
+        return (bytes + pageBytes - 1) / pageBytes * pageBytes;
+    }
+
+    static bool isZero(const uint8_t* entry) {
+        static const uint8_t ZERO[sizeof(T)] = {};
+        return std::memcmp(entry, ZERO, sizeof(T)) == 0;
+    }
+};
+
+#endif // WORD_TABLE_H